@@ -0,0 +1,127 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <time.h>
+#include <libopencm3/stm32/rtc.h>
+#include <libopencm3/stm32/can.h>
+#include <libopencm3/cm3/dwt.h>
+#include "hoststubs.h"
+#include "stm32_can.h"
+#include "digio.h"
+#include "params.h"
+#include "timebase.h"
+#include "journal.h"
+
+uint64_t HostStubs::micros = 0;
+HostStubs::CanSink HostStubs::canSink = 0;
+HostStubs::PinSink HostStubs::pinSink = 0;
+HostStubs::JournalSink HostStubs::journalSink = 0;
+uint32_t HostStubs::txFrames = 0;
+uint32_t HostStubs::pinChanges = 0;
+uint32_t HostStubs::journalRecords = 0;
+
+void HostStubs::Advance(uint32_t us)
+{
+   micros += us;
+
+   while (Timebase::Millis() != (uint32_t)(micros / 1000))
+      Timebase::Tick();
+}
+
+void HostStubs::RecordTx(uint32_t id, const uint32_t data[2], uint8_t len)
+{
+   txFrames++;
+   if (canSink) canSink(id, data, len);
+}
+
+void HostStubs::RecordPin(const char* name, bool level)
+{
+   pinChanges++;
+   if (pinSink) pinSink(name, level);
+}
+
+void HostStubs::RecordJournal(uint8_t type, uint8_t value)
+{
+   journalRecords++;
+   if (journalSink) journalSink(type, value);
+}
+
+// Stm32Can
+static Stm32Can can0;
+
+Stm32Can* Stm32Can::GetInterface(int index)
+{
+   return index == 0 ? &can0 : 0;
+}
+
+void Stm32Can::Send(uint32_t canId, uint32_t data[2], uint8_t len)
+{
+   HostStubs::RecordTx(canId, data, len);
+}
+
+// DigIo
+#define DIG_IO_ENTRY(name, port, pin, mode) DigIo DigIo::name(#name);
+DIG_IO_LIST
+#undef DIG_IO_ENTRY
+
+void DigIo::Write(bool newLevel)
+{
+   if (newLevel == level) return;
+
+   level = newLevel;
+   HostStubs::RecordPin(name, level);
+}
+
+// Timebase, without the SysTick counter the microseconds come from the simulated clock
+volatile uint32_t Timebase::ms = 0;
+
+uint32_t Timebase::Micros()
+{
+   return (uint32_t)HostStubs::GetMicros();
+}
+
+// Journal, records are handed to the sink instead of being queued for the flash
+void Journal::Log(RecordType type, uint8_t value)
+{
+   HostStubs::RecordJournal(type, value);
+}
+
+// libopencm3
+volatile uint32_t host_can_tsr = CAN_TSR_TME0 | CAN_TSR_TME1 | CAN_TSR_TME2;
+
+uint32_t rtc_get_counter_val(void)
+{
+   return HostStubs::GetMicros() / 1000000;
+}
+
+uint32_t host_dwt_cyccnt(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 72000000 + (uint64_t)ts.tv_nsec * 72 / 1000;
+}
+
+// errormessage.cpp is not built, the list only serves as the unit of lasterr
+const char* errorListString = "";
+
+// The firmware reacts to parameter changes in main.cpp, nothing to do on the host
+void Param::Change(Param::PARAM_NUM)
+{
+}
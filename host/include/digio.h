@@ -0,0 +1,51 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DIGIO_H_INCLUDED
+#define DIGIO_H_INCLUDED
+
+#include <stdint.h>
+#include "digio_prj.h"
+
+/* Host stand-in for libopeninv's DigIo. Same pins as DIG_IO_LIST, writes are recorded
+ * through HostStubs when they change the level. */
+class DigIo
+{
+public:
+   DigIo(const char* name) : name(name), level(false) {}
+
+#define DIG_IO_ENTRY(name, port, pin, mode) static DigIo name;
+   DIG_IO_LIST
+#undef DIG_IO_ENTRY
+
+   bool Get() { return level; }
+   void Set() { Write(true); }
+   void Clear() { Write(false); }
+   void Toggle() { Write(!level); }
+   const char* GetName() const { return name; }
+
+private:
+   void Write(bool newLevel);
+
+   const char* name;
+   bool level;
+};
+
+#endif // DIGIO_H_INCLUDED
@@ -0,0 +1,72 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HOSTSTUBS_H_INCLUDED
+#define HOSTSTUBS_H_INCLUDED
+
+#include <stdint.h>
+
+/* Recording stand-ins for the hardware, used by "make host" instead of libopencm3.
+ *
+ * The headers in host/include shadow stm32_can.h, digio.h and the few libopencm3
+ * registers the control logic reads. Frames sent through Stm32Can, pin changes and
+ * journal records are counted and handed to the sinks, if any are set.
+ *
+ * Time is simulated: it only moves with Advance(), which ticks Timebase once per
+ * millisecond and derives Micros() and the RTC seconds from the same clock, so a
+ * session runs as fast as the host can compute it. The DWT cycle counter is the
+ * exception, it follows the host clock scaled to the 72MHz of the MCU, so the
+ * profiler probes show what the logic costs on the host. */
+class HostStubs
+{
+public:
+   typedef void (*CanSink)(uint32_t id, const uint32_t data[2], uint8_t len);
+   typedef void (*PinSink)(const char* name, bool level);
+   typedef void (*JournalSink)(uint8_t type, uint8_t value);
+
+   /** Moves the simulated clock forward by us */
+   static void Advance(uint32_t us);
+   /** Simulated time since start, does not wrap */
+   static uint64_t GetMicros() { return micros; }
+
+   static void SetCanSink(CanSink s) { canSink = s; }
+   static void SetPinSink(PinSink s) { pinSink = s; }
+   static void SetJournalSink(JournalSink s) { journalSink = s; }
+
+   static uint32_t GetTxFrames() { return txFrames; }
+   static uint32_t GetPinChanges() { return pinChanges; }
+   static uint32_t GetJournalRecords() { return journalRecords; }
+
+   // Called by the stubs
+   static void RecordTx(uint32_t id, const uint32_t data[2], uint8_t len);
+   static void RecordPin(const char* name, bool level);
+   static void RecordJournal(uint8_t type, uint8_t value);
+
+private:
+   static uint64_t micros;
+   static CanSink canSink;
+   static PinSink pinSink;
+   static JournalSink journalSink;
+   static uint32_t txFrames;
+   static uint32_t pinChanges;
+   static uint32_t journalRecords;
+};
+
+#endif // HOSTSTUBS_H_INCLUDED
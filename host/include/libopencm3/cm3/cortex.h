@@ -0,0 +1,27 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HOST_CORTEX_H_INCLUDED
+#define HOST_CORTEX_H_INCLUDED
+
+/* The host tools run the tasks and the receive path from one thread, nothing to mask */
+static inline bool cm_mask_interrupts(bool) { return false; }
+
+#endif // HOST_CORTEX_H_INCLUDED
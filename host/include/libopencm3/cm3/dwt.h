@@ -0,0 +1,33 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HOST_DWT_H_INCLUDED
+#define HOST_DWT_H_INCLUDED
+
+#include <stdint.h>
+
+/* Host clock in 72MHz cycles, so Profiler reports host execution time in MCU units */
+extern "C" uint32_t host_dwt_cyccnt(void);
+
+#define DWT_CYCCNT host_dwt_cyccnt()
+
+static inline bool dwt_enable_cycle_counter(void) { return true; }
+
+#endif // HOST_DWT_H_INCLUDED
@@ -0,0 +1,36 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HOST_CAN_H_INCLUDED
+#define HOST_CAN_H_INCLUDED
+
+#include <stdint.h>
+
+/* Just the transmit status register, which TxScheduler polls for free mailboxes.
+ * Reads as all three mailboxes empty unless a simulation says otherwise. */
+extern "C" volatile uint32_t host_can_tsr;
+
+#define CAN1              0
+#define CAN_TSR(can_base) host_can_tsr
+#define CAN_TSR_TME0      (1 << 26)
+#define CAN_TSR_TME1      (1 << 27)
+#define CAN_TSR_TME2      (1 << 28)
+
+#endif // HOST_CAN_H_INCLUDED
@@ -0,0 +1,57 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PCSSIM_H_INCLUDED
+#define PCSSIM_H_INCLUDED
+
+#include <stdint.h>
+
+/* Behavioural model of a Model 3 PCS for closed-loop sessions on the host.
+ *
+ * It listens to the frames the controller sends (0x22A, 0x2B2, 0x13D, 0x23D, 0x3A1) and
+ * to its enable pins, and answers with 0x204, 0x2B4, 0x264, 0x2A4, 0x2C4, 0x3A4 and
+ * 0x424 at the periods in the frame table of pcssim.cpp. Modelled are the CHG_STAT
+ * sequence from INIT to ENABLE and back through SHUTDOWN or FAULTED, the grid
+ * configuration and line voltage, the AC power slew within the pilot and hardware
+ * limits, the DC-DC regulating to the 0x3A1 setpoint, a battery that charges with the
+ * delivered energy, first order heating of the phases and the DC-DC with derating, the
+ * lifetime energy counters and injectable alerts and faults.
+ *
+ * Run() advances the model by one millisecond, the caller drives it from its clock so
+ * a session runs as fast as the host computes it. The numbers are plausible rather
+ * than measured, they are named in pcssim.cpp so they can be tuned against a log. */
+class PcsSim
+{
+public:
+   typedef void (*FrameSink)(uint32_t id, uint32_t data[2], uint8_t len);
+
+   /** Restores all settings and the state to their defaults, frames go to sink */
+   static void Init(FrameSink sink);
+   /** A frame sent by the controller */
+   static void Receive(uint32_t id, const uint32_t data[2], uint8_t len);
+   /** Advances the model to nowMs, call once per millisecond */
+   static void Run(uint32_t nowMs);
+   /** Changes a setting, see the table in pcssim.cpp. Returns false for an unknown key */
+   static bool Set(const char* key, double value);
+   /** Reads a setting or a state variable, false for an unknown key */
+   static bool Get(const char* key, double& value);
+};
+
+#endif // PCSSIM_H_INCLUDED
@@ -0,0 +1,34 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef STM32_CAN_H_INCLUDED
+#define STM32_CAN_H_INCLUDED
+
+#include <stdint.h>
+
+/* Host stand-in for libopeninv's Stm32Can: sending records the frame, see HostStubs */
+class Stm32Can
+{
+public:
+   static Stm32Can* GetInterface(int index);
+   void Send(uint32_t canId, uint32_t data[2], uint8_t len);
+};
+
+#endif // STM32_CAN_H_INCLUDED
@@ -0,0 +1,690 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "PCSCan.h"
+#include "pcssignal.h"
+#include "pcsshadow.h"
+#include "params.h"
+
+/* Host benchmark and equivalence check of the PCS receive handlers. Usage:
+ *
+ *    pcsbench [-n rounds]
+ *
+ * Runs the same random payloads (fixed seed, valid mux ids for 0x2C4 and 0x76C)
+ * through three versions of the handlers and prints the time per frame of each: the
+ * byte shuffling handlers of the original code, the float handlers on CanSignal::Phys()
+ * that followed, both kept below as they were, and the fixed point handlers of PCSCan.
+ *
+ * Before timing, every payload goes through the float and the fixed point handlers
+ * and the published values are compared. Each decoded signal must match within one
+ * s32fp LSB (1/32), values added up from several signals within one LSB per signal and
+ * the DC-DC power within the product of those bounds. The exit code is 2 if not.
+ *
+ * These are host numbers. The host FPU makes the float math of the original code
+ * cheap, on the Cortex-M3 it runs in libgcc. The cycle counts on the target are the
+ * rxNNN profiler probes, this shows the cost of the decoding relative to each other.
+ * The current 0x204 and 0x3A4 handlers also journal state changes and keep the alert
+ * event log, which random payloads trigger on almost every frame. */
+
+enum { FRAMES = 1024 };
+
+typedef void (*Handler)(uint32_t data[2]);
+
+// The receive handlers as they were before the CanSignal templates
+namespace Baseline
+{
+static bool Backup2c4 = true;
+static bool GotDCI = false;
+static uint16_t DCDCAmps = 0;
+static uint16_t ACLim = 0;
+static float ACPwr = 0;
+static float ChgPavail = 0;
+static float DCDCPwr = 0;
+static uint16_t ACVolts = 0;
+static uint16_t ACAmps = 0;
+static uint16_t HVVolts = 0;
+static float LVVolts = 0;
+static float IOut_PhA = 0;
+static float IOut_PhB = 0;
+static float IOut_PhC = 0;
+static float IOut_Total = 0;
+static float ChgPhAKWh = 0;
+static float ChgPhBKWh = 0;
+static float ChgPhCKWh = 0;
+static float DcdcOutKWh = 0;
+static const float CHG_EFFICIENCY_EST = 0.95f;
+static uint16_t AmbTemp = 0;
+static uint16_t ATemp = 0;
+static uint16_t BTemp = 0;
+static uint16_t CTemp = 0;
+static uint16_t DCDCTemp = 0;
+static uint16_t DCDCBTemp = 0;
+static uint8_t PCSGrid = 0;
+static uint8_t PCS_HW = 0;
+static uint8_t PCS_CHG_STAT = 0;
+static uint8_t mux2C4 = 0;
+static uint8_t mux76C = 0;
+static uint8_t PCSBootId = 0;
+static uint8_t PCSAlertPage = 0;
+static uint8_t PCSAlertId = 0;
+static uint16_t AlertCANId = 0;
+static uint8_t AlertRxError = 0;
+static uint8_t pcs_alert_active[121] = {0};
+
+static int16_t ProcessTemps(uint16_t InVal)
+{
+   int16_t value = InVal & 0x3ff;
+   if (InVal & 0x400)
+      value -= 0x3ff;
+   value = value * 0.1 + 40;
+   value = InVal & 0x3ff;
+   if (InVal & 0x400)
+      value -= 0x3ff;
+   value = value * 0.1 + 40;
+   return value;
+}
+
+static void ProcessCANRat(uint16_t, uint8_t)
+{
+}
+
+static void handle204(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+
+   PCS_HW = (bytes[7] >> 3) & 0x03;
+   Param::SetInt(Param::PCS_Type, PCS_HW);
+   if (PCS_HW == 0)
+      Param::SetInt(Param::hwaclim, 48);
+   if (PCS_HW == 1)
+      Param::SetInt(Param::hwaclim, 32);
+   if (PCS_HW == 2)
+      Param::SetInt(Param::hwaclim, 16);
+
+   PCS_CHG_STAT = (bytes[0]) & 0x0f;
+   Param::SetInt(Param::CHG_STAT, PCS_CHG_STAT);
+
+   ChgPavail = bytes[3] * 0.1f;
+   Param::SetFloat(Param::CHGPAvail, ChgPavail);
+
+   PCSGrid = (bytes[0] >> 6) & 0x3;
+   Param::SetInt(Param::GridCFG, PCSGrid);
+}
+
+static void handle2B4(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+
+   LVVolts = ((bytes[0] | ((bytes[1] & 0x03) << 8)) * 0.0390625);
+   Param::SetFloat(Param::ulv, LVVolts);
+
+   DCDCAmps = (((bytes[3] | ((bytes[4] & 0x0F) << 8)) & 0xFFF) * 0.1);
+   Param::SetFloat(Param::idcdc, DCDCAmps);
+
+   DCDCPwr = DCDCAmps * LVVolts;
+   Param::SetFloat(Param::powerdcdc, DCDCPwr);
+}
+
+static void handle264(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+
+   ACLim = (((bytes[5] << 8 | bytes[4]) & 0x3ff) * 0.1);
+   ACPwr = ((bytes[3]) * .1f);
+   ACVolts = (((bytes[1] << 8 | bytes[0]) & 0x3FFF) * 0.033);
+   ACAmps = (((bytes[2] << 9 | bytes[1]) >> 7) * 0.1);
+
+   Param::SetFloat(Param::powerac, ACPwr);
+   Param::SetFloat(Param::uac, ACVolts);
+   Param::SetFloat(Param::iac, ACAmps);
+   Param::SetFloat(Param::ChgACLim, ACLim);
+}
+
+static void handle2A4(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+
+   ATemp = ((bytes[1] << 8 | bytes[0]));
+   BTemp = ((bytes[2] << 8 | bytes[1]) >> 3);
+   CTemp = ((bytes[4] << 15 | bytes[3] << 7 | bytes[2] >> 1) >> 5);
+   DCDCTemp = ((bytes[5] << 8 | bytes[4]) >> 1);
+   DCDCBTemp = (((bytes[7] << 8 | bytes[6]) >> 7) & 0x1FF) * 0.293542;
+   AmbTemp = ((bytes[6] << 8 | bytes[5]) >> 4);
+   Param::SetFloat(Param::ChgATemp, ProcessTemps(ATemp));
+   Param::SetFloat(Param::ChgBTemp, ProcessTemps(BTemp));
+   Param::SetFloat(Param::ChgCTemp, ProcessTemps(CTemp));
+   Param::SetFloat(Param::DCDCTemp, ProcessTemps(DCDCTemp));
+   Param::SetFloat(Param::DCDCBTemp, DCDCBTemp);
+   Param::SetFloat(Param::PCSAmbTemp, ProcessTemps(AmbTemp));
+}
+
+static void handle2C4(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+   mux2C4 = (bytes[0]);
+   if ((mux2C4 == 0xE6) || (mux2C4 == 0xC6))
+   {
+      HVVolts = (((bytes[3] << 8 | bytes[2]) & 0xFFF) * 0.146484);
+      Backup2c4 = false;
+   }
+   else if ((mux2C4 == 0x04) && (Backup2c4))
+   {
+      HVVolts = ((((bytes[7] << 8 | bytes[6]) >> 3) & 0xFFF) * 0.146484);
+   }
+   Param::SetFloat(Param::udc, HVVolts);
+
+   mux2C4 = (bytes[0] & 0x1F);
+   if (mux2C4 == 0x00)
+   {
+      IOut_PhA = ((bytes[4])) * 0.1f;
+      GotDCI = true;
+   }
+   else if (mux2C4 == 0x01)
+   {
+      IOut_PhB = ((bytes[4])) * 0.1f;
+      GotDCI = true;
+   }
+   else if (mux2C4 == 0x02)
+   {
+      IOut_PhC = ((bytes[4])) * 0.1f;
+      GotDCI = true;
+   }
+
+   IOut_Total = IOut_PhA + IOut_PhB + IOut_PhC;
+   Param::SetFloat(Param::idc, IOut_Total);
+
+   if (mux2C4 == 0x0A)
+   {
+      ChgPhAKWh = ((bytes[3] >> 7) | (bytes[4] << 1) | (bytes[5] << 9) | ((bytes[6] & 0x7F) << 17)) * 0.01f;
+   }
+   else if (mux2C4 == 0x0B)
+   {
+      ChgPhBKWh = ((bytes[3] >> 7) | (bytes[4] << 1) | (bytes[5] << 9) | ((bytes[6] & 0x7F) << 17)) * 0.01f;
+   }
+   else if (mux2C4 == 0x0C)
+   {
+      ChgPhCKWh = ((bytes[3] >> 7) | (bytes[4] << 1) | (bytes[5] << 9) | ((bytes[6] & 0x7F) << 17)) * 0.01f;
+      Param::SetFloat(Param::PCSAcKWh, ChgPhAKWh + ChgPhBKWh + ChgPhCKWh);
+   }
+   else if (mux2C4 == 0x16)
+   {
+      DcdcOutKWh = (bytes[1] | (bytes[2] << 8) | (bytes[3] << 16)) * 0.01f;
+      Param::SetFloat(Param::PCSDcdcKWh, DcdcOutKWh);
+   }
+
+   float battKWh = (ChgPhAKWh + ChgPhBKWh + ChgPhCKWh - DcdcOutKWh) * CHG_EFFICIENCY_EST;
+   Param::SetFloat(Param::PCSBattKWh, battKWh > 0 ? battKWh : 0);
+}
+
+static void handle3A4(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+   uint8_t page = bytes[0] & 0x0F;
+   PCSAlertPage = page;
+   for (uint8_t bit = 4; bit < 64; bit++)
+   {
+      uint8_t id = page * 60 + (bit - 3);
+      if (id > 102)
+         break;
+      pcs_alert_active[id] = (bytes[bit >> 3] >> (bit & 0x07)) & 0x01;
+   }
+}
+
+static void handle424(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+   PCSAlertId = bytes[0];
+
+   if (PCSAlertId == 0x1E)
+   {
+      AlertCANId = ((bytes[4] << 8 | bytes[3]));
+      AlertRxError = (bytes[2] & 0x07);
+      ProcessCANRat(AlertCANId, AlertRxError);
+   }
+}
+
+static void handle504(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+   PCSBootId = bytes[7];
+   Param::SetInt(Param::PCSBoot, PCSBootId);
+}
+
+static void handle76C(uint32_t data[2])
+{
+   uint8_t *bytes = (uint8_t *)data;
+   mux76C = (bytes[0]);
+   if (!GotDCI)
+   {
+      if (mux76C == 0x0C)
+      {
+         IOut_PhA = ((bytes[2] << 8 | bytes[1]) & 0x3ff) * 0.0025f;
+      }
+      else if (mux76C == 0x16)
+      {
+         IOut_PhB = ((bytes[2] << 8 | bytes[1]) & 0x3ff) * 0.0025f;
+      }
+      else if (mux76C == 0x20)
+      {
+         IOut_PhC = ((bytes[2] << 8 | bytes[1]) & 0x3ff) * 0.0025f;
+      }
+
+      IOut_Total = IOut_PhA + IOut_PhB + IOut_PhC;
+      Param::SetFloat(Param::idc, IOut_Total);
+   }
+}
+}
+
+// The float handlers on CanSignal::Phys() that came before the fixed point path
+namespace Float
+{
+typedef CanSignal<0,  4>                                  PCS_chgMainState;
+typedef CanSignal<6,  2>                                  PCS_gridConfig;
+typedef CanSignal<24, 8,  SIG_INTEL, false, 1, 10>        PCS_chgPwrAvailable;
+typedef CanSignal<59, 2>                                  PCS_hwVariantType;
+typedef CanSignal<0,  10, SIG_INTEL, false, 5, 128>       PCS_dcdcLvBusVolt;
+typedef CanSignal<24, 12, SIG_INTEL, false, 1, 10>        PCS_dcdcLvOutputCurrent;
+typedef CanSignal<0,  14, SIG_INTEL, false, 33, 1000>     PCS_chgLineVoltage;
+typedef CanSignal<14, 9,  SIG_INTEL, false, 1, 10>        PCS_chgLineCurrent;
+typedef CanSignal<24, 8,  SIG_INTEL, false, 1, 10>        PCS_chgLinePower;
+typedef CanSignal<32, 10, SIG_INTEL, false, 1, 10>        PCS_chgLineCurrentLimit;
+typedef CanSignal<0,  11, SIG_INTEL, true,  1, 10, 40>    PCS_chgPhATemp;
+typedef CanSignal<11, 11, SIG_INTEL, true,  1, 10, 40>    PCS_chgPhBTemp;
+typedef CanSignal<22, 11, SIG_INTEL, true,  1, 10, 40>    PCS_chgPhCTemp;
+typedef CanSignal<33, 11, SIG_INTEL, true,  1, 10, 40>    PCS_dcdcTemp;
+typedef CanSignal<44, 11, SIG_INTEL, true,  1, 10, 40>    PCS_ambientTemp;
+typedef CanSignal<55, 9,  SIG_INTEL, false, 150, 511>     PCS_dcdcBTemp;
+typedef CanSignal<0,  8>                                  PCS_logMessageSelect;
+typedef CanSignal<0,  5>                                  PCS_logMux;
+typedef CanSignal<16, 12, SIG_INTEL, false, 75, 512>      PCS_dcdcHvBusVolt;
+typedef CanSignal<51, 12, SIG_INTEL, false, 75, 512>      PCS_chgHvBusVolt;
+typedef CanSignal<32, 8,  SIG_INTEL, false, 1, 10>        PCS_chgPhOutputCurrent;
+typedef CanSignal<31, 24, SIG_INTEL, false, 1, 100>       PCS_chgPhLifetimeKWh;
+typedef CanSignal<8,  24, SIG_INTEL, false, 1, 100>       PCS_dcdcLifetimeKWh;
+typedef CanSignal<56, 8>                                  PCS_bootId;
+typedef CanSignal<0,  8>                                  PCS_dbgMux;
+typedef CanSignal<8,  10, SIG_INTEL, false, 1, 400>       PCS_dbgChgPhOutputCurrent;
+
+static bool Backup2c4 = true;
+static bool GotDCI = false;
+static float DCDCAmps = 0;
+static float ACLim = 0;
+static float ACPwr = 0;
+static float ChgPavail = 0;
+static float DCDCPwr = 0;
+static float ACVolts = 0;
+static float ACAmps = 0;
+static uint16_t HVVolts = 0;
+static float LVVolts = 0;
+static float IOut_PhA = 0;
+static float IOut_PhB = 0;
+static float IOut_PhC = 0;
+static float IOut_Total = 0;
+static float ChgPhAKWh = 0;
+static float ChgPhBKWh = 0;
+static float ChgPhCKWh = 0;
+static float DcdcOutKWh = 0;
+static const float CHG_EFFICIENCY_EST = 0.95f;
+static uint8_t PCSGrid = 0;
+static uint8_t PCS_HW = 0;
+static uint8_t PCS_CHG_STAT = 0;
+static uint8_t mux2C4 = 0;
+static uint8_t mux76C = 0;
+static uint8_t PCSBootId = 0;
+
+static void handle204(uint32_t data[2])
+{
+   PCS_HW = PCS_hwVariantType::Raw(data);
+   Param::SetInt(Param::PCS_Type, PCS_HW);
+   if (PCS_HW == 0)
+      Param::SetInt(Param::hwaclim, 48);
+   if (PCS_HW == 1)
+      Param::SetInt(Param::hwaclim, 32);
+   if (PCS_HW == 2)
+      Param::SetInt(Param::hwaclim, 16);
+
+   PCS_CHG_STAT = PCS_chgMainState::Raw(data);
+   Param::SetInt(Param::CHG_STAT, PCS_CHG_STAT);
+
+   ChgPavail = PCS_chgPwrAvailable::Phys(data);
+   Param::SetFloat(Param::CHGPAvail, ChgPavail);
+
+   PCSGrid = PCS_gridConfig::Raw(data);
+   Param::SetInt(Param::GridCFG, PCSGrid);
+}
+
+static void handle2B4(uint32_t data[2])
+{
+   LVVolts = PCS_dcdcLvBusVolt::Phys(data);
+   Param::SetFloat(Param::ulv, LVVolts);
+
+   DCDCAmps = PCS_dcdcLvOutputCurrent::Phys(data);
+   Param::SetFloat(Param::idcdc, DCDCAmps);
+
+   DCDCPwr = DCDCAmps * LVVolts;
+   Param::SetFloat(Param::powerdcdc, DCDCPwr);
+}
+
+static void handle264(uint32_t data[2])
+{
+   ACLim = PCS_chgLineCurrentLimit::Phys(data);
+   ACPwr = PCS_chgLinePower::Phys(data);
+   ACVolts = PCS_chgLineVoltage::Phys(data);
+   ACAmps = PCS_chgLineCurrent::Phys(data);
+
+   Param::SetFloat(Param::powerac, ACPwr);
+   Param::SetFloat(Param::uac, ACVolts);
+   Param::SetFloat(Param::iac, ACAmps);
+   Param::SetFloat(Param::ChgACLim, ACLim);
+}
+
+static void handle2A4(uint32_t data[2])
+{
+   Param::SetFloat(Param::ChgATemp, PCS_chgPhATemp::Phys(data));
+   Param::SetFloat(Param::ChgBTemp, PCS_chgPhBTemp::Phys(data));
+   Param::SetFloat(Param::ChgCTemp, PCS_chgPhCTemp::Phys(data));
+   Param::SetFloat(Param::DCDCTemp, PCS_dcdcTemp::Phys(data));
+   Param::SetFloat(Param::DCDCBTemp, PCS_dcdcBTemp::Phys(data));
+   Param::SetFloat(Param::PCSAmbTemp, PCS_ambientTemp::Phys(data));
+}
+
+static void handle2C4(uint32_t data[2])
+{
+   uint8_t select = PCS_logMessageSelect::Raw(data);
+   if ((select == 0xE6) || (select == 0xC6))
+   {
+      HVVolts = PCS_dcdcHvBusVolt::Phys(data);
+      Backup2c4 = false;
+   }
+   else if ((select == 0x04) && (Backup2c4))
+   {
+      HVVolts = PCS_chgHvBusVolt::Phys(data);
+   }
+   Param::SetFloat(Param::udc, HVVolts);
+
+   mux2C4 = PCS_logMux::Raw(data);
+   if (mux2C4 == 0x00)
+   {
+      IOut_PhA = PCS_chgPhOutputCurrent::Phys(data);
+      GotDCI = true;
+   }
+   else if (mux2C4 == 0x01)
+   {
+      IOut_PhB = PCS_chgPhOutputCurrent::Phys(data);
+      GotDCI = true;
+   }
+   else if (mux2C4 == 0x02)
+   {
+      IOut_PhC = PCS_chgPhOutputCurrent::Phys(data);
+      GotDCI = true;
+   }
+
+   IOut_Total = IOut_PhA + IOut_PhB + IOut_PhC;
+   Param::SetFloat(Param::idc, IOut_Total);
+
+   if (mux2C4 == 0x0A)
+   {
+      ChgPhAKWh = PCS_chgPhLifetimeKWh::Phys(data);
+   }
+   else if (mux2C4 == 0x0B)
+   {
+      ChgPhBKWh = PCS_chgPhLifetimeKWh::Phys(data);
+   }
+   else if (mux2C4 == 0x0C)
+   {
+      ChgPhCKWh = PCS_chgPhLifetimeKWh::Phys(data);
+      Param::SetFloat(Param::PCSAcKWh, ChgPhAKWh + ChgPhBKWh + ChgPhCKWh);
+   }
+   else if (mux2C4 == 0x16)
+   {
+      DcdcOutKWh = PCS_dcdcLifetimeKWh::Phys(data);
+      Param::SetFloat(Param::PCSDcdcKWh, DcdcOutKWh);
+   }
+
+   float battKWh = (ChgPhAKWh + ChgPhBKWh + ChgPhCKWh - DcdcOutKWh) * CHG_EFFICIENCY_EST;
+   Param::SetFloat(Param::PCSBattKWh, battKWh > 0 ? battKWh : 0);
+}
+
+static void handle504(uint32_t data[2])
+{
+   PCSBootId = PCS_bootId::Raw(data);
+   Param::SetInt(Param::PCSBoot, PCSBootId);
+}
+
+static void handle76C(uint32_t data[2])
+{
+   mux76C = PCS_dbgMux::Raw(data);
+   if (!GotDCI)
+   {
+      if (mux76C == 0x0C)
+      {
+         IOut_PhA = PCS_dbgChgPhOutputCurrent::Phys(data);
+      }
+      else if (mux76C == 0x16)
+      {
+         IOut_PhB = PCS_dbgChgPhOutputCurrent::Phys(data);
+      }
+      else if (mux76C == 0x20)
+      {
+         IOut_PhC = PCS_dbgChgPhOutputCurrent::Phys(data);
+      }
+
+      IOut_Total = IOut_PhA + IOut_PhB + IOut_PhC;
+      Param::SetFloat(Param::idc, IOut_Total);
+   }
+}
+}
+
+static void Current3A4(uint32_t data[2])
+{
+   PCSCan::handle3A4(data, 0);
+}
+
+// Published value of a message and how far the fixed point result may be off
+struct Check
+{
+   Param::PARAM_NUM value;
+   int tolerance;   // s32fp LSB, 0 = product of ulv and idcdc
+};
+
+struct Message
+{
+   uint16_t id;
+   Handler baseline;
+   Handler floating;
+   Handler current;
+   const uint8_t* muxes; // valid values of byte 0, 0 = any
+   uint8_t muxCount;
+   const Check* checks;
+   uint8_t checkCount;
+};
+
+static const uint8_t muxes2C4[] = { 0x00, 0x01, 0x02, 0x04, 0x0A, 0x0B, 0x0C, 0x16, 0xC6, 0xE6 };
+static const uint8_t muxes3A4[] = { 0, 1 };
+static const uint8_t muxes424[] = { 0x1E, 0x33 };
+static const uint8_t muxes76C[] = { 0x0C, 0x16, 0x20 };
+
+static const Check checks204[] =
+{
+   { Param::PCS_Type, 0 }, { Param::hwaclim, 0 }, { Param::CHG_STAT, 0 }, { Param::CHGPAvail, 1 }, { Param::GridCFG, 0 }
+};
+static const Check checks2B4[] = { { Param::ulv, 1 }, { Param::idcdc, 1 }, { Param::powerdcdc, 0 } };
+static const Check checks264[] = { { Param::powerac, 1 }, { Param::uac, 1 }, { Param::iac, 1 }, { Param::ChgACLim, 1 } };
+static const Check checks2A4[] =
+{
+   { Param::ChgATemp, 1 }, { Param::ChgBTemp, 1 }, { Param::ChgCTemp, 1 },
+   { Param::DCDCTemp, 1 }, { Param::DCDCBTemp, 1 }, { Param::PCSAmbTemp, 1 }
+};
+static const Check checks2C4[] =
+{
+   { Param::udc, 0 }, { Param::idc, 3 }, { Param::PCSAcKWh, 3 }, { Param::PCSDcdcKWh, 1 }, { Param::PCSBattKWh, 4 }
+};
+static const Check checks76C[] = { { Param::idc, 3 } };
+static const Check checks504[] = { { Param::PCSBoot, 0 } };
+
+#define CHECKS(c) c, sizeof(c) / sizeof(c[0])
+
+// 0x76C goes before 0x2C4, its currents are only used until 0x2C4 provided them.
+// 0x3A4 and 0x424 only feed the alert handling, they have no float version.
+static const Message messages[] =
+{
+   { 0x204, Baseline::handle204, Float::handle204, PCSCan::handle204, 0, 0, CHECKS(checks204) },
+   { 0x2B4, Baseline::handle2B4, Float::handle2B4, PCSCan::handle2B4, 0, 0, CHECKS(checks2B4) },
+   { 0x264, Baseline::handle264, Float::handle264, PCSCan::handle264, 0, 0, CHECKS(checks264) },
+   { 0x2A4, Baseline::handle2A4, Float::handle2A4, PCSCan::handle2A4, 0, 0, CHECKS(checks2A4) },
+   { 0x76C, Baseline::handle76C, Float::handle76C, PCSCan::handle76C, muxes76C, sizeof(muxes76C), CHECKS(checks76C) },
+   { 0x2C4, Baseline::handle2C4, Float::handle2C4, PCSCan::handle2C4, muxes2C4, sizeof(muxes2C4), CHECKS(checks2C4) },
+   { 0x3A4, Baseline::handle3A4, 0, Current3A4, muxes3A4, sizeof(muxes3A4), 0, 0 },
+   { 0x424, Baseline::handle424, 0, PCSCan::handle424, muxes424, sizeof(muxes424), 0, 0 },
+   { 0x504, Baseline::handle504, Float::handle504, PCSCan::handle504, 0, 0, CHECKS(checks504) },
+};
+
+static uint32_t frames[FRAMES][2];
+
+// xorshift32, the same payloads on every run
+static uint32_t Random()
+{
+   static uint32_t state = 0x2545F491;
+
+   state ^= state << 13;
+   state ^= state >> 17;
+   state ^= state << 5;
+   return state;
+}
+
+static void MakeFrames(const Message& m)
+{
+   for (int i = 0; i < FRAMES; i++)
+   {
+      frames[i][0] = Random();
+      frames[i][1] = Random();
+      if (m.muxes)
+         frames[i][0] = (frames[i][0] & ~0xFFu) | m.muxes[Random() % m.muxCount];
+   }
+}
+
+static double NanoSeconds()
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Runs the frames through the float and the fixed point handler, returns the number
+// of values out of tolerance and the largest deviation in LSB
+static int Compare(const Message& m, int& maxLsb)
+{
+   s32fp current[PcsShadow::NUM_FIELDS];
+   int failures = 0;
+
+   maxLsb = 0;
+   for (int c = 0; c < m.checkCount; c++)
+      current[c] = Param::Get(m.checks[c].value);
+
+   for (int i = 0; i < FRAMES; i++)
+   {
+      s32fp floating[PcsShadow::NUM_FIELDS];
+      uint32_t data[2] = { frames[i][0], frames[i][1] };
+
+      // Both write to Param, so each starts from what the fixed point path published last
+      m.floating(data);
+      for (int c = 0; c < m.checkCount; c++)
+      {
+         floating[c] = Param::Get(m.checks[c].value);
+         Param::SetFixed(m.checks[c].value, current[c]);
+      }
+
+      m.current(data);
+      PcsShadow::Publish();
+
+      for (int c = 0; c < m.checkCount; c++)
+      {
+         current[c] = Param::Get(m.checks[c].value);
+
+         int lsb = abs(current[c] - floating[c]);
+         int tolerance = m.checks[c].tolerance;
+
+         // A product of two values that are within 1 LSB each
+         if (tolerance == 0 && m.checks[c].value == Param::powerdcdc)
+            tolerance = (Param::Get(Param::ulv) + Param::Get(Param::idcdc)) / 32 + 2;
+
+         if (lsb > maxLsb) maxLsb = lsb;
+         if (lsb > tolerance)
+         {
+            if (failures++ < 5)
+               printf("%03X %08X%08X: %s float %.5f fixed %.5f\n", m.id, frames[i][1], frames[i][0],
+                      Param::GetAttrib(m.checks[c].value)->name, floating[c] / 32.0, current[c] / 32.0);
+         }
+      }
+   }
+   return failures;
+}
+
+// ns per frame
+static double Time(Handler handler, int rounds)
+{
+   double start = NanoSeconds();
+
+   for (int r = 0; r < rounds; r++)
+      for (int i = 0; i < FRAMES; i++)
+         handler(frames[i]);
+
+   return (NanoSeconds() - start) / ((double)rounds * FRAMES);
+}
+
+int main(int argc, char* argv[])
+{
+   int rounds = 2000;
+
+   if (argc == 3 && strcmp(argv[1], "-n") == 0)
+      rounds = atoi(argv[2]);
+   else if (argc != 1)
+   {
+      fprintf(stderr, "usage: %s [-n rounds]\n", argv[0]);
+      return 1;
+   }
+
+   int failures = 0;
+
+   Param::LoadDefaults();
+
+   printf("id   baseline_ns float_ns current_ns max_lsb\n");
+   for (unsigned i = 0; i < sizeof(messages) / sizeof(messages[0]); i++)
+   {
+      const Message& m = messages[i];
+      int maxLsb = 0;
+
+      MakeFrames(m);
+      if (m.floating)
+         failures += Compare(m, maxLsb);
+
+      printf("%03X  %11.2f %8.2f %10.2f %7d\n", m.id, Time(m.baseline, rounds),
+             m.floating ? Time(m.floating, rounds) : 0, Time(m.current, rounds), maxLsb);
+   }
+
+   if (failures > 0)
+      printf("%d values out of tolerance\n", failures);
+   return failures > 0 ? 2 : 0;
+}
@@ -0,0 +1,481 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <termios.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <net/if.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include "hoststubs.h"
+#include "pcssim.h"
+#include "chargecontrol.h"
+#include "params.h"
+#include "busstats.h"
+#include "txsched.h"
+#include "timebase.h"
+
+/* Runs the charge control as a Linux process on a SocketCAN interface, for bench work
+ * with a USB-CAN adapter or for local tests on vcan0. Usage:
+ *
+ *    pcsd [-i interface] [-r priority] [-s]
+ *
+ * A 1ms timerfd stands in for the SysTick and the TIM2 scheduler and runs the tasks of
+ * main.cpp in the same order, received frames go through the same CanCallback
+ * dispatch. -r runs the process SCHED_FIFO with the given priority and locks its
+ * memory, -s adds the PcsSim plant: its frames go out on the bus and to the controller,
+ * so vcan0 carries the full PCS traffic without any hardware.
+ *
+ * The terminal is a pseudo-tty, its name is printed on startup. It understands
+ * "get name[,name...]", "set name value", "all" and "jitter", the latter prints the
+ * send interval statistics of every transmitted id, taken at the write() to the
+ * socket, and how late the timer woke the loop. SDO and the firmware's own terminal
+ * commands are not available, they need libopeninv's hardware drivers. */
+
+enum { MAX_IDS = 32 };
+
+// Send intervals of one id, mean and deviation by Welford's method
+struct TxJitter
+{
+   uint16_t id;
+   uint32_t count;
+   uint64_t last;        // us
+   double mean;          // us
+   double m2;
+   uint32_t min;         // us
+   uint32_t max;         // us
+};
+
+static volatile sig_atomic_t running = 1;
+static bool plant = false;
+static int canFd = -1;
+static uint64_t startUs;
+static TxJitter jitter[MAX_IDS];
+static int jitterIds = 0;
+static uint32_t txErrors = 0;
+static uint32_t wakeups = 0;
+static uint32_t missedTicks = 0;
+static uint64_t lateSum = 0;
+static uint32_t lateMax = 0;
+
+static uint64_t MonotonicUs()
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void Stop(int)
+{
+   running = 0;
+}
+
+static void RecordJitter(uint32_t id, uint64_t now)
+{
+   TxJitter* j = 0;
+
+   for (int i = 0; i < jitterIds && j == 0; i++)
+      if (jitter[i].id == id) j = &jitter[i];
+
+   if (j == 0)
+   {
+      if (jitterIds == MAX_IDS) return;
+      j = &jitter[jitterIds++];
+      memset(j, 0, sizeof(*j));
+      j->id = id;
+      j->min = 0xFFFFFFFF;
+   }
+
+   if (j->last != 0)
+   {
+      uint32_t interval = now - j->last;
+      double delta = interval - j->mean;
+
+      j->count++;
+      j->mean += delta / j->count;
+      j->m2 += delta * (interval - j->mean);
+      if (interval < j->min) j->min = interval;
+      if (interval > j->max) j->max = interval;
+   }
+   j->last = now;
+}
+
+static void ResetJitter()
+{
+   jitterIds = 0;
+   wakeups = missedTicks = lateMax = 0;
+   lateSum = 0;
+}
+
+static void WriteFrame(uint32_t id, const uint32_t data[2], uint8_t len)
+{
+   struct can_frame f;
+
+   memset(&f, 0, sizeof(f));
+   f.can_id = id;
+   f.can_dlc = len;
+   memcpy(f.data, data, len);
+
+   if (write(canFd, &f, sizeof(f)) != sizeof(f))
+      txErrors++;
+}
+
+// Everything the controller sends, through the Stm32Can stub
+static void SendFrame(uint32_t id, const uint32_t data[2], uint8_t len)
+{
+   WriteFrame(id, data, len);
+   RecordJitter(id, MonotonicUs());
+   if (plant) PcsSim::Receive(id, data, len);
+}
+
+// Same dispatch as CanCallback in main.cpp, less the SDO server
+static bool CanCallback(uint32_t id, uint32_t data[2], uint8_t dlc)
+{
+   BusStats::CountRx(id, dlc);
+   ChargeControl::Receive(id, data, dlc);
+   return false;
+}
+
+// Plant frames are on the bus for everyone else and received by us
+static void PlantFrame(uint32_t id, uint32_t data[2], uint8_t len)
+{
+   WriteFrame(id, data, len);
+   CanCallback(id, data, len);
+}
+
+// The tasks of one millisecond in the order of main.cpp, Ms100Task's main loop work right after it
+static void RunTasks(uint32_t now)
+{
+   if (plant) PcsSim::Run(now);
+
+   if (now % 100 == 0)
+   {
+      BusStats::Update();
+      ChargeControl::Run();
+      ChargeControl::DebounceFaults();
+      ChargeControl::PackVcuStatus();
+   }
+   if (now % 10 == 0)
+      ChargeControl::DecodeRxFrames();
+   if (now % TxScheduler::SLOT_MS == 0)
+      TxScheduler::Run(ChargeControl::IsCanEnabled(), Param::GetInt(Param::txmingap));
+}
+
+// Catches the simulated clock up with the real one, running the tasks of every millisecond
+// passed. Micros() then reads the real time, for the latency measurements of the RX path.
+static void SyncClock()
+{
+   uint64_t real = MonotonicUs() - startUs;
+
+   while (HostStubs::GetMicros() / 1000 < real / 1000)
+   {
+      HostStubs::Advance(1000 - HostStubs::GetMicros() % 1000);
+      RunTasks(Timebase::Millis());
+   }
+   HostStubs::Advance(real - HostStubs::GetMicros());
+}
+
+static void OnTimer(int fd)
+{
+   uint64_t expirations;
+
+   if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+
+   uint32_t late = (MonotonicUs() - startUs) % 1000;
+
+   wakeups++;
+   missedTicks += expirations - 1;
+   lateSum += late;
+   if (late > lateMax) lateMax = late;
+
+   SyncClock();
+}
+
+static void OnCan(int fd)
+{
+   struct can_frame f;
+
+   while (read(fd, &f, sizeof(f)) == sizeof(f))
+   {
+      uint32_t data[2] = { 0, 0 };
+
+      if (f.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) continue;
+
+      memcpy(data, f.data, f.can_dlc > 8 ? 8 : f.can_dlc);
+      SyncClock();
+      CanCallback(f.can_id, data, f.can_dlc);
+   }
+}
+
+static void PrintJitter(FILE* out, const char* eol)
+{
+   fprintf(out, "id    frames  mean_ms  stddev_us  min_us   max_us%s", eol);
+   for (int i = 0; i < jitterIds; i++)
+   {
+      const TxJitter& j = jitter[i];
+
+      if (j.count == 0) continue;
+      fprintf(out, "%03X  %7u  %7.3f  %9.1f  %7u  %7u%s", j.id, j.count, j.mean / 1000,
+              sqrt(j.m2 / j.count), j.min, j.max, eol);
+   }
+   fprintf(out, "timer: %u wakeups, %u missed ticks, late by %.1f us mean, %u us max, %u tx errors%s",
+           wakeups, missedTicks, wakeups ? (double)lateSum / wakeups : 0.0, lateMax, txErrors, eol);
+}
+
+static void PrintValue(FILE* out, const char* name)
+{
+   Param::PARAM_NUM p = Param::NumFromString(name);
+
+   if (p == Param::PARAM_INVALID)
+      fprintf(out, "Unknown parameter %s\r\n", name);
+   else
+      fprintf(out, "%g\r\n", Param::GetFloat(p));
+}
+
+static void Command(FILE* out, char* line)
+{
+   char* cmd = strtok(line, " \t\r\n");
+   char* arg1 = strtok(0, " \t\r\n");
+   char* arg2 = strtok(0, " \t\r\n");
+
+   if (cmd == 0) return;
+
+   if (strcmp(cmd, "get") == 0 && arg1)
+   {
+      for (char* name = strtok(arg1, ","); name; name = strtok(0, ","))
+         PrintValue(out, name);
+   }
+   else if (strcmp(cmd, "set") == 0 && arg1 && arg2)
+   {
+      Param::PARAM_NUM p = Param::NumFromString(arg1);
+
+      if (p == Param::PARAM_INVALID)
+         fprintf(out, "Unknown parameter %s\r\n", arg1);
+      else if (Param::GetType(p) != Param::TYPE_PARAM)
+      {
+         Param::SetFixed(p, FP_FROMFLT(atof(arg2)));
+         fprintf(out, "Set OK\r\n");
+      }
+      else if (Param::Set(p, FP_FROMFLT(atof(arg2))) == 0)
+         fprintf(out, "Set OK\r\n");
+      else
+         fprintf(out, "Value out of range\r\n");
+   }
+   else if (strcmp(cmd, "all") == 0)
+   {
+      for (int p = 0; p < Param::PARAM_LAST; p++)
+         fprintf(out, "%s\t\t%g\r\n", Param::GetAttrib((Param::PARAM_NUM)p)->name, Param::GetFloat((Param::PARAM_NUM)p));
+   }
+   else if (strcmp(cmd, "jitter") == 0)
+   {
+      if (arg1 && strcmp(arg1, "reset") == 0)
+         ResetJitter();
+      else
+         PrintJitter(out, "\r\n");
+   }
+   else
+   {
+      fprintf(out, "Unknown command sequence\r\n");
+   }
+   fflush(out);
+}
+
+// The pty is raw, so we echo like the firmware terminal does
+static void OnTerminal(int fd, FILE* out)
+{
+   static char line[128];
+   static size_t len = 0;
+   char buf[64];
+   ssize_t n = read(fd, buf, sizeof(buf));
+
+   for (ssize_t i = 0; i < n; i++)
+   {
+      if (buf[i] == '\r' || buf[i] == '\n')
+      {
+         fputs("\r\n", out);
+         line[len] = 0;
+         Command(out, line);
+         len = 0;
+      }
+      else if (len < sizeof(line) - 1)
+      {
+         fputc(buf[i], out);
+         line[len++] = buf[i];
+      }
+   }
+   fflush(out);
+}
+
+static int OpenCan(const char* name)
+{
+   struct sockaddr_can addr;
+   struct ifreq ifr;
+   int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+
+   if (fd < 0) return -1;
+
+   memset(&ifr, 0, sizeof(ifr));
+   strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+   if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0)
+   {
+      close(fd);
+      return -1;
+   }
+
+   memset(&addr, 0, sizeof(addr));
+   addr.can_family = AF_CAN;
+   addr.can_ifindex = ifr.ifr_ifindex;
+   if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      close(fd);
+      return -1;
+   }
+   fcntl(fd, F_SETFL, O_NONBLOCK);
+   return fd;
+}
+
+// Master side of a raw pty. We keep the slave open as well, so the master does not
+// hang up whenever a terminal program disconnects.
+static int OpenTerminal()
+{
+   struct termios tio;
+   int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+   if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0)
+      return -1;
+
+   int slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+
+   if (slave < 0 || tcgetattr(slave, &tio) < 0)
+      return -1;
+
+   cfmakeraw(&tio);
+   tcsetattr(slave, TCSANOW, &tio);
+   fcntl(fd, F_SETFL, O_NONBLOCK);
+   return fd;
+}
+
+int main(int argc, char* argv[])
+{
+   const char* itf = "vcan0";
+   int priority = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "i:r:s")) != -1)
+   {
+      switch (opt)
+      {
+      case 'i': itf = optarg; break;
+      case 'r': priority = atoi(optarg); break;
+      case 's': plant = true; break;
+      default:
+         fprintf(stderr, "usage: %s [-i interface] [-r priority] [-s]\n", argv[0]);
+         return 1;
+      }
+   }
+
+   if ((canFd = OpenCan(itf)) < 0)
+   {
+      perror(itf);
+      return 1;
+   }
+
+   int ptyFd = OpenTerminal();
+   int timerFd = timerfd_create(CLOCK_MONOTONIC, 0);
+
+   if (ptyFd < 0 || timerFd < 0)
+   {
+      perror("pty/timer");
+      return 1;
+   }
+
+   FILE* term = fdopen(dup(ptyFd), "w");
+
+   if (priority > 0)
+   {
+      struct sched_param sp;
+
+      sp.sched_priority = priority;
+      if (sched_setscheduler(0, SCHED_FIFO, &sp) < 0 || mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+         perror("real-time scheduling");
+   }
+
+   Param::LoadDefaults();
+   Param::SetInt(Param::version, 4);
+   BusStats::Init();
+   TxScheduler::Init(ChargeControl::GetTxSlots(), ChargeControl::GetTxSlotCount());
+   HostStubs::SetCanSink(SendFrame);
+   PcsSim::Init(PlantFrame);
+
+   signal(SIGINT, Stop);
+   signal(SIGTERM, Stop);
+
+   // The timer runs on the millisecond grid of the simulated clock
+   startUs = MonotonicUs();
+   struct itimerspec its;
+   its.it_interval.tv_sec = 0;
+   its.it_interval.tv_nsec = 1000000;
+   its.it_value.tv_sec = startUs / 1000000;
+   its.it_value.tv_nsec = (startUs % 1000000) * 1000 + 1000000;
+   if (its.it_value.tv_nsec >= 1000000000)
+   {
+      its.it_value.tv_sec++;
+      its.it_value.tv_nsec -= 1000000000;
+   }
+   timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &its, 0);
+
+   fprintf(stderr, "pcsd on %s, terminal on %s%s\n", itf, ptsname(ptyFd), plant ? ", with PCS model" : "");
+
+   struct pollfd fds[3] =
+   {
+      { timerFd, POLLIN, 0 },
+      { canFd, POLLIN, 0 },
+      { ptyFd, POLLIN, 0 },
+   };
+
+   while (running)
+   {
+      if (poll(fds, 3, -1) < 0)
+      {
+         if (errno == EINTR) continue;
+         perror("poll");
+         break;
+      }
+      if (fds[0].revents & POLLIN) OnTimer(timerFd);
+      if (fds[1].revents & POLLIN) OnCan(canFd);
+      if (fds[2].revents & POLLIN) OnTerminal(ptyFd, term);
+   }
+
+   PrintJitter(stderr, "\n");
+   return 0;
+}
@@ -0,0 +1,522 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hoststubs.h"
+#include "chargecontrol.h"
+#include "params.h"
+#include "busstats.h"
+#include "timebase.h"
+
+/* Replays a candump or Vector ASC log through the receive path of the firmware and
+ * writes every parameter and value on a fixed time grid. Usage:
+ *
+ *    pcsreplay [-t ms] [-c channel] [-b] [-o file] log
+ *
+ * Frame lines in these formats are used, everything else (headers, comments, error,
+ * remote, extended ID and CAN FD frames) is skipped:
+ *
+ *    (1700000000.123456) can0 204#0011223344556677            candump -l or -L
+ *    (1700000000.123456)  can0  204   [8]  00 11 22 33 ...     candump -ta
+ *       12.345678 1  204             Rx   d 8 00 11 22 ...    ASC, base hex or dec
+ *
+ * Every frame goes through BusStats::CountRx and ChargeControl::Receive like in
+ * CanCallback. The simulated clock follows the log timestamps and the 10ms and 100ms
+ * tasks run on its grid, so ring drops, PCS MIA ages and the 3A4 timing come out as
+ * the firmware would have seen them. The transmit side does not run, the frames of
+ * the controller that made the log are in it already.
+ *
+ * Every -t ms (default 100, a multiple of 10) one row follows the tasks of that tick:
+ * the log time and every entry of the parameter list, in list order. CSV starts with a
+ * line of names and prints the s32fp values exactly. -b writes binary instead: the line
+ * "pcsreplay <int32 per row> <fraction bits> <start time>", the line of names, then per
+ * row the ms since the first frame and the raw s32fp of each entry as little endian
+ * int32, e.g. np.fromfile(f, '<i4', offset=<size of both lines>).reshape(-1, n)
+ *
+ * -c takes only the frames of one candump interface or ASC channel. The log is mapped
+ * and parsed in place, nothing is allocated per frame.
+ *
+ * The acceptance filters of the firmware are not applied, so the bus load values count
+ * every frame of the log where the firmware only sees the filtered IDs. */
+
+enum { TICK_US = 10000 };
+
+// One frame of the log
+struct LogFrame
+{
+   uint64_t us;
+   uint32_t id;
+   uint32_t data[2];
+   uint8_t len;
+};
+
+static const char* channel = 0;
+static size_t channelLen = 0;
+static bool binary = false;
+static uint32_t rowMs = 100;
+static FILE* out = stdout;
+static bool ascDecimal = false;   // "base dec"
+static bool ascRelative = false;  // "timestamps relative"
+static uint64_t ascLastUs = 0;
+static bool started = false;
+static uint64_t logStartUs = 0;   // timestamp of the first frame
+static uint64_t nextTickUs = 0;   // simulated time of the next 10ms tick
+static uint32_t frames = 0;
+static uint32_t decoded = 0;
+static uint32_t skipped = 0;
+static uint32_t rows = 0;
+static char buf[1 << 20];
+static size_t bufLen = 0;
+
+static inline bool IsBlank(char c)
+{
+   return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline int HexDigit(char c)
+{
+   if (c >= '0' && c <= '9') return c - '0';
+   c |= 0x20;
+   if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+   return -1;
+}
+
+static const char* SkipBlanks(const char* p, const char* end)
+{
+   while (p < end && IsBlank(*p)) p++;
+   return p;
+}
+
+static const char* SkipToken(const char* p, const char* end)
+{
+   while (p < end && !IsBlank(*p)) p++;
+   return p;
+}
+
+static bool ChannelMatches(const char* p, const char* end)
+{
+   return channel == 0 || ((size_t)(end - p) == channelLen && memcmp(p, channel, channelLen) == 0);
+}
+
+// Unsigned number, returns 0 when there is no digit
+static const char* ParseNumber(const char* p, const char* end, uint32_t& value, int base)
+{
+   const char* start = p;
+   int digit;
+
+   value = 0;
+   while (p < end && (digit = HexDigit(*p)) >= 0 && digit < base)
+   {
+      value = value * base + digit;
+      p++;
+   }
+   return p > start ? p : 0;
+}
+
+// Seconds with up to 6 decimals
+static const char* ParseTime(const char* p, const char* end, uint64_t& us)
+{
+   uint32_t sec, frac = 0;
+   int digits = 0;
+
+   if ((p = ParseNumber(p, end, sec, 10)) == 0) return 0;
+
+   if (p < end && *p == '.')
+   {
+      for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+      {
+         if (digits < 6)
+         {
+            frac = frac * 10 + *p - '0';
+            digits++;
+         }
+      }
+   }
+   for (; digits < 6; digits++)
+      frac *= 10;
+
+   us = (uint64_t)sec * 1000000 + frac;
+   return p;
+}
+
+// Up to 8 payload bytes in hex, byte 0 first, with or without blanks in between
+static uint8_t ParsePayload(const char* p, const char* end, uint32_t data[2])
+{
+   uint8_t len = 0;
+
+   data[0] = data[1] = 0;
+   for (p = SkipBlanks(p, end); len < 8 && p + 1 < end; p = SkipBlanks(p, end))
+   {
+      int hi = HexDigit(p[0]), lo = HexDigit(p[1]);
+
+      if (hi < 0 || lo < 0) break;
+
+      data[len / 4] |= (uint32_t)(hi << 4 | lo) << (8 * (len % 4));
+      len++;
+      p += 2;
+   }
+   return len;
+}
+
+// candump -l/-L "(time) itf id#payload" and candump -t "(time) itf id [len] bytes"
+static bool ParseCandump(const char* p, const char* end, LogFrame& f)
+{
+   uint32_t len;
+
+   if ((p = ParseTime(p + 1, end, f.us)) == 0 || p >= end || *p != ')') return false;
+
+   const char* itf = SkipBlanks(p + 1, end);
+
+   p = SkipToken(itf, end);
+   if (!ChannelMatches(itf, p)) return false;
+
+   const char* id = SkipBlanks(p, end);
+
+   if ((p = ParseNumber(id, end, f.id, 16)) == 0 || p >= end) return false;
+   if (p - id > 3) return false; // extended ids are printed with 8 digits
+
+   if (*p == '#')
+   {
+      // "##" is CAN FD, "#R" a remote frame
+      if (p + 1 < end && (p[1] == '#' || p[1] == 'R')) return false;
+      f.len = ParsePayload(p + 1, end, f.data);
+      return true;
+   }
+
+   p = SkipBlanks(p, end);
+   if (p >= end || *p != '[' || (p = ParseNumber(p + 1, end, len, 10)) == 0) return false;
+   if (p >= end || *p != ']' || len > 8) return false;
+
+   // Remote frames print "remote request" where the bytes would be
+   f.len = ParsePayload(p + 1, end, f.data);
+   return f.len == len;
+}
+
+// ASC "time channel id[x] Rx|Tx d len bytes"
+static bool ParseAsc(const char* p, const char* end, LogFrame& f)
+{
+   uint32_t unused, len;
+
+   if ((p = ParseTime(p, end, f.us)) == 0) return false;
+
+   if (ascRelative)
+      f.us += ascLastUs;
+   ascLastUs = f.us;
+
+   const char* chan = SkipBlanks(p, end);
+
+   // "CANFD", "ErrorFrame", "Statistic:" and the like fail here
+   if ((p = ParseNumber(chan, end, unused, 10)) == 0 || p >= end || !IsBlank(*p)) return false;
+   if (!ChannelMatches(chan, p)) return false;
+
+   if ((p = ParseNumber(SkipBlanks(p, end), end, f.id, ascDecimal ? 10 : 16)) == 0) return false;
+   if (p >= end || !IsBlank(*p)) return false; // "x" marks an extended id
+
+   p = SkipToken(SkipBlanks(p, end), end); // Rx or Tx
+   p = SkipBlanks(p, end);
+   if (p + 1 >= end || p[0] != 'd' || !IsBlank(p[1])) return false; // "r" is a remote frame
+
+   if ((p = ParseNumber(SkipBlanks(p + 1, end), end, len, 10)) == 0 || len > 8) return false;
+
+   f.len = ParsePayload(p, end, f.data);
+   return f.len == len;
+}
+
+// "base hex|dec  timestamps absolute|relative"
+static void ParseAscBase(const char* p, const char* end)
+{
+   ascDecimal = memmem(p, end - p, "dec", 3) != 0;
+   ascRelative = memmem(p, end - p, "relative", 8) != 0;
+}
+
+static void Flush()
+{
+   fwrite(buf, 1, bufLen, out);
+   bufLen = 0;
+}
+
+static char* PutUint(char* p, uint64_t value)
+{
+   char digits[20];
+   int n = 0;
+
+   do
+   {
+      digits[n++] = '0' + value % 10;
+      value /= 10;
+   } while (value > 0);
+
+   while (n > 0)
+      *p++ = digits[--n];
+   return p;
+}
+
+// s32fp to decimal, exact: a fraction of 2^-CST_DIGITS has at most CST_DIGITS decimals
+static char* PutFixed(char* p, s32fp value)
+{
+   uint32_t magnitude = value < 0 ? -(uint32_t)value : value;
+   uint32_t frac = magnitude & ((1 << CST_DIGITS) - 1);
+
+   if (value < 0) *p++ = '-';
+   p = PutUint(p, magnitude >> CST_DIGITS);
+
+   if (frac != 0)
+   {
+      int digits = CST_DIGITS;
+
+      for (int i = 0; i < CST_DIGITS; i++)
+         frac *= 5; // frac / 2^n = frac * 5^n / 10^n
+      while (frac % 10 == 0)
+      {
+         frac /= 10;
+         digits--;
+      }
+
+      char* last = p + digits;
+
+      *p++ = '.';
+      for (char* d = last; d >= p; d--)
+      {
+         *d = '0' + frac % 10;
+         frac /= 10;
+      }
+      p = last + 1;
+   }
+   return p;
+}
+
+static void PutInt32(int32_t value)
+{
+   memcpy(buf + bufLen, &value, sizeof(value)); // the host is little endian
+   bufLen += sizeof(value);
+}
+
+static void WriteHeader()
+{
+   if (binary)
+      fprintf(out, "pcsreplay %d %d %llu.%06u\n", Param::PARAM_LAST + 1, CST_DIGITS,
+              (unsigned long long)(logStartUs / 1000000), (unsigned)(logStartUs % 1000000));
+
+   fprintf(out, "time");
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+      fprintf(out, ",%s", Param::GetAttrib((Param::PARAM_NUM)i)->name);
+   fprintf(out, "\n");
+}
+
+static void WriteRow(uint32_t ms)
+{
+   if (bufLen + (Param::PARAM_LAST + 1) * 24 > sizeof(buf))
+      Flush();
+
+   rows++;
+
+   if (binary)
+   {
+      PutInt32(ms);
+      for (int i = 0; i < Param::PARAM_LAST; i++)
+         PutInt32(Param::Get((Param::PARAM_NUM)i));
+      return;
+   }
+
+   uint64_t us = logStartUs + (uint64_t)ms * 1000;
+   char* p = PutUint(buf + bufLen, us / 1000000);
+   uint32_t micros = us % 1000000;
+
+   *p++ = '.';
+   for (int i = 5; i >= 0; i--, micros /= 10)
+      p[i] = '0' + micros % 10;
+   p += 6;
+
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+   {
+      *p++ = ',';
+      p = PutFixed(p, Param::Get((Param::PARAM_NUM)i));
+   }
+   *p++ = '\n';
+   bufLen = p - buf;
+}
+
+// One 10ms tick of the firmware in the order of runner.cpp, without the TX slots
+static void RunTick()
+{
+   HostStubs::Advance(nextTickUs - HostStubs::GetMicros());
+   nextTickUs += TICK_US;
+
+   uint32_t now = Timebase::Millis();
+
+   if (now % 100 == 0)
+   {
+      BusStats::Update();
+      ChargeControl::Run();
+      ChargeControl::DebounceFaults();
+      ChargeControl::PackVcuStatus();
+   }
+   ChargeControl::DecodeRxFrames();
+
+   if (now % rowMs == 0)
+      WriteRow(now);
+}
+
+static void Feed(LogFrame& f)
+{
+   if (!started)
+   {
+      started = true;
+      logStartUs = f.us;
+      WriteHeader();
+   }
+
+   // Frames that go back in time, e.g. from merged logs, arrive "now". A frame stamped
+   // on a tick is received before its tasks, like the plant frames in runner.cpp
+   uint64_t t = f.us > logStartUs ? f.us - logStartUs : 0;
+
+   while (nextTickUs < t)
+      RunTick();
+   if (t > HostStubs::GetMicros())
+      HostStubs::Advance(t - HostStubs::GetMicros());
+
+   frames++;
+   BusStats::CountRx(f.id, f.len);
+   if (ChargeControl::Receive(f.id, f.data, f.len))
+      decoded++;
+}
+
+static void Replay(const char* log, size_t size)
+{
+   const char* end = log + size;
+   LogFrame f;
+
+   for (const char* line = log; line < end; )
+   {
+      const char* eol = (const char*)memchr(line, '\n', end - line);
+      const char* p;
+      bool ok = false;
+
+      if (eol == 0) eol = end;
+      p = SkipBlanks(line, eol);
+
+      if (p == eol)
+         ok = true; // empty line, not counted
+      else if (*p == '(')
+         ok = ParseCandump(p, eol, f);
+      else if (*p >= '0' && *p <= '9')
+         ok = ParseAsc(p, eol, f);
+      else if (eol - p > 5 && memcmp(p, "base ", 5) == 0)
+         ParseAscBase(p, eol);
+
+      if (!ok)
+         skipped++;
+      else if (p != eol)
+         Feed(f);
+
+      line = eol + 1;
+   }
+}
+
+static double MonotonicSeconds()
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+   const char* outName = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "t:c:bo:")) != -1)
+   {
+      switch (opt)
+      {
+      case 't': rowMs = atoi(optarg); break;
+      case 'c': channel = optarg; channelLen = strlen(optarg); break;
+      case 'b': binary = true; break;
+      case 'o': outName = optarg; break;
+      default: optind = argc + 1; break;
+      }
+   }
+
+   if (optind != argc - 1 || rowMs == 0 || rowMs % 10 != 0)
+   {
+      fprintf(stderr, "usage: %s [-t ms] [-c channel] [-b] [-o file] log\n", argv[0]);
+      return 1;
+   }
+
+   int fd = open(argv[optind], O_RDONLY);
+   struct stat st;
+
+   if (fd < 0 || fstat(fd, &st) < 0)
+   {
+      perror(argv[optind]);
+      return 1;
+   }
+
+   const char* log = st.st_size > 0 ? (const char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : 0;
+
+   if (log == MAP_FAILED || log == 0)
+   {
+      fprintf(stderr, "%s: empty or cannot be mapped\n", argv[optind]);
+      return 1;
+   }
+   madvise((void*)log, st.st_size, MADV_SEQUENTIAL);
+
+   if (outName && (out = fopen(outName, "wb")) == 0)
+   {
+      perror(outName);
+      return 1;
+   }
+
+   Param::LoadDefaults();
+   Param::SetInt(Param::version, 4);
+   BusStats::Init();
+
+   double start = MonotonicSeconds();
+
+   Replay(log, st.st_size);
+
+   if (!started)
+   {
+      fprintf(stderr, "%s: no frames%s%s\n", argv[optind], channel ? " on " : "", channel ? channel : "");
+      return 1;
+   }
+
+   // Decode what the last frames left in the ring
+   for (uint64_t last = HostStubs::GetMicros(); nextTickUs <= last + TICK_US; )
+      RunTick();
+   Flush();
+
+   double elapsed = MonotonicSeconds() - start;
+
+   fprintf(stderr, "%u frames, %u to the PCS/VCU decoders, %u lines skipped, %.1f s of log in %.3f s "
+           "(%.2f M frames/s), %u rows, %d ring drops\n",
+           frames, decoded, skipped, HostStubs::GetMicros() / 1e6, elapsed, frames / elapsed / 1e6,
+           rows, Param::GetInt(Param::canrxdrop));
+
+   return out != stdout && fclose(out) != 0 ? 1 : 0;
+}
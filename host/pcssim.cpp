@@ -0,0 +1,555 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "pcssim.h"
+#include "params.h"
+#include "digio.h"
+
+// CHG_STAT dwell times in ms
+#define T_INIT        1000  // after power up
+#define T_STARTUP     500
+#define T_QUALIFY     2000  // line qualification
+#define T_CONFIG      500
+#define T_SHUTDOWN    1000
+#define T_CLR_FAULTS  500
+#define MIA_MS        1000  // without 0x22A the PCS drops out of charging
+
+// Charger and DC-DC
+#define AC_SLEW_W_S   2000.0  // internal power slew towards the request, downwards is immediate
+#define CHG_EFF       0.95    // AC to HV
+#define DCDC_EFF      0.92    // HV to LV
+#define ULV_TAU_S     0.2     // LV bus settling
+#define MIN_ULINE     85.0    // below this there is no AC
+
+// Battery, open circuit voltage linear in SOC plus the internal resistance
+#define RBAT_OHM      0.1
+
+// Thermal, first order: steady state rise per kW and time constant
+#define K_PHASE_C_KW  12.0
+#define TAU_PHASE_S   600.0
+#define K_DCDC_C_KW   50.0
+#define TAU_DCDC_S    300.0
+#define DERATE_START  80.0    // phase temperature where the available power starts to drop
+#define DERATE_END    95.0    // ... and where it is zero
+#define OVERTEMP_ON   100.0
+#define OVERTEMP_OFF  90.0
+
+// Alert ids the model raises by itself
+#define ALERT_CAN_RAT   0x1E   // CAN rationality, 0x424 names 0x22A with rx error MIA_RX_ERROR
+#define ALERT_OVERTEMP  0x33
+#define MIA_RX_ERROR    3
+
+enum { NUM_PHASES = 3 };
+
+// Settings and state, the ones in the key table are readable by name
+static struct
+{
+   // settings
+   double uline;        // V per phase
+   double grid;         // 0 none, 1 1P, 2 3P, 3 3P delta
+   double hw;           // 0 48A 1P, 1 32A 1P, 2 16A 3P
+   double ambient;      // C
+   double ubatmin;      // V at SOC 0
+   double ubatmax;      // V at SOC 1
+   double capacity;     // kWh
+   double lvload;       // A drawn from the DC-DC
+   double lvbat;        // V of the 12V battery without the DC-DC
+   double fault;        // != 0 forces FAULTED
+   // state
+   double soc;          // 0..1, also a setting
+   double pac;          // W from the line
+   double pdc;          // W into the HV bus
+   double ubat;         // V
+   double ulv;          // V
+   double ilv;          // A
+   double iline;        // A per phase
+   double avail;        // W the charger could draw now
+   double tphase[NUM_PHASES];
+   double tdcdc;
+   double ackwh[NUM_PHASES];
+   double dcdckwh;
+   double chgstat;
+} m;
+
+struct Key
+{
+   const char* name;
+   double* value;
+   bool writable;
+};
+
+static const Key keys[] =
+{
+   { "uline", &m.uline, true },     { "grid", &m.grid, true },         { "hw", &m.hw, true },
+   { "ambient", &m.ambient, true }, { "ubatmin", &m.ubatmin, true },   { "ubatmax", &m.ubatmax, true },
+   { "capacity", &m.capacity, true }, { "lvload", &m.lvload, true },   { "lvbat", &m.lvbat, true },
+   { "fault", &m.fault, true },     { "soc", &m.soc, true },           { "ackwha", &m.ackwh[0], true },
+   { "ackwhb", &m.ackwh[1], true }, { "ackwhc", &m.ackwh[2], true },   { "dcdckwh", &m.dcdckwh, true },
+   { "pac", &m.pac, false },        { "pdc", &m.pdc, false },
+   { "ubat", &m.ubat, false },      { "ulv", &m.ulv, false },          { "ilv", &m.ilv, false },
+   { "iline", &m.iline, false },    { "avail", &m.avail, false },      { "tpha", &m.tphase[0], false },
+   { "tphb", &m.tphase[1], false }, { "tphc", &m.tphase[2], false },   { "tdcdc", &m.tdcdc, false },
+   { "chgstat", &m.chgstat, false },
+};
+
+// What the controller told us
+static struct
+{
+   bool chgBit;        // 0x22A charger enable
+   bool dcdcBit;       // 0x22A DC-DC enable
+   uint32_t last22A;   // ms, 0 = not seen since power up
+   uint16_t powerReq;  // 0x2B2, W
+   bool reqEnable;     // 0x2B2 byte 2
+   bool cpEnable;      // 0x13D/0x23D byte 0
+   double pilotA;       // 0x13D/0x23D byte 1
+   double dcdcSpnt;     // 0x3A1, V
+} in;
+
+static PcsSim::FrameSink sink;
+static uint32_t now;
+static bool powered;
+static uint8_t state;
+static uint32_t stateSince;
+static uint64_t alerts[2];        // bit id-1
+static uint8_t pending424;        // alert id to report, 0 = none
+static uint8_t mux2C4;
+static uint8_t page3A4;
+
+// Intel field of up to 32 bits, value saturated to the field
+static void Put(uint32_t data[2], int start, int len, double value)
+{
+   uint32_t max = 0xFFFFFFFFu >> (32 - len);
+   uint32_t raw = value <= 0 ? 0 : value >= max ? max : (uint32_t)(value + 0.5);
+   uint64_t word = ((uint64_t)data[1] << 32) | data[0];
+
+   word |= (uint64_t)raw << start;
+   data[0] = word;
+   data[1] = word >> 32;
+}
+
+// Two's complement field
+static void PutSigned(uint32_t data[2], int start, int len, double value)
+{
+   int32_t half = 1 << (len - 1);
+   int32_t raw = value < -half ? -half : value > half - 1 ? half - 1 : (int32_t)(value + (value < 0 ? -0.5 : 0.5));
+
+   Put(data, start, len, (double)(raw & ((1 << len) - 1)));
+}
+
+static void Send(uint32_t id, uint32_t data[2], uint8_t len)
+{
+   if (sink) sink(id, data, len);
+}
+
+static int Phases()
+{
+   return m.hw == 2 && m.grid >= 2 ? 3 : 1;
+}
+
+static bool AcPresent()
+{
+   return m.grid != 0 && m.uline > MIN_ULINE;
+}
+
+static void SetAlert(uint8_t id, bool active)
+{
+   uint64_t bit = 1ull << ((id - 1) % 64);
+   uint64_t& word = alerts[(id - 1) / 64];
+
+   if (id < 1 || id > 120) return;
+   if (active && !(word & bit)) pending424 = id;
+   word = active ? word | bit : word & ~bit;
+}
+
+static bool AlertActive(uint8_t id)
+{
+   return (alerts[(id - 1) / 64] >> ((id - 1) % 64)) & 1;
+}
+
+static void Enter(uint8_t newState)
+{
+   state = newState;
+   stateSince = now;
+}
+
+static void Send204()
+{
+   uint32_t data[2] = { 0, 0 };
+
+   Put(data, 0, 4, state);
+   Put(data, 6, 2, m.grid);
+   Put(data, 24, 8, m.avail / 100);
+   Put(data, 59, 2, m.hw);
+   Send(0x204, data, 8);
+}
+
+static void Send2B4()
+{
+   uint32_t data[2] = { 0, 0 };
+
+   Put(data, 0, 10, m.ulv * 128 / 5);
+   Put(data, 24, 12, m.ilv * 10);
+   Send(0x2B4, data, 8);
+}
+
+static void Send264()
+{
+   uint32_t data[2] = { 0, 0 };
+   double lineA = m.hw == 0 ? 48 : m.hw == 1 ? 32 : 16;
+
+   Put(data, 0, 14, m.uline * 1000 / 33);
+   Put(data, 14, 9, m.iline * 10);
+   Put(data, 24, 8, m.pac / 100);
+   Put(data, 32, 10, (in.pilotA < lineA ? in.pilotA : lineA) * 10);
+   Send(0x264, data, 8);
+}
+
+static void Send2A4()
+{
+   uint32_t data[2] = { 0, 0 };
+   double pcsAmbient = m.ambient + (m.tphase[0] + m.tdcdc - 2 * m.ambient) / 4;
+
+   PutSigned(data, 0, 11, (m.tphase[0] - 40) * 10);
+   PutSigned(data, 11, 11, (m.tphase[1] - 40) * 10);
+   PutSigned(data, 22, 11, (m.tphase[2] - 40) * 10);
+   PutSigned(data, 33, 11, (m.tdcdc - 40) * 10);
+   PutSigned(data, 44, 11, (pcsAmbient - 40) * 10);
+   Put(data, 55, 9, (m.tdcdc - 2) * 511 / 150);
+   Send(0x2A4, data, 8);
+}
+
+// One mux per frame, in turn all the ones PCSCan::handle2C4() decodes
+static void Send2C4()
+{
+   static const uint8_t muxes[] = { 0x00, 0x01, 0x02, 0x04, 0x06, 0x0A, 0x0B, 0x0C, 0x16 };
+   uint8_t mux = muxes[mux2C4];
+   uint32_t data[2] = { mux, 0 };
+   int phases = Phases();
+
+   mux2C4 = (mux2C4 + 1) % sizeof(muxes);
+
+   switch (mux)
+   {
+   case 0x00: case 0x01: case 0x02:
+      Put(data, 32, 8, mux < phases ? m.pdc / phases / m.ubat * 10 : 0);
+      break;
+   case 0x04:
+      Put(data, 51, 12, m.ubat * 512 / 75);
+      break;
+   case 0x06:
+      data[0] = 0xC6;
+      Put(data, 16, 12, m.ubat * 512 / 75);
+      break;
+   case 0x0A: case 0x0B: case 0x0C:
+      Put(data, 31, 24, m.ackwh[mux - 0x0A] * 100);
+      break;
+   case 0x16:
+      Put(data, 8, 24, m.dcdckwh * 100);
+      break;
+   }
+   Send(0x2C4, data, 8);
+}
+
+// The pages take turns, each carries 60 alerts from bit 4 on
+static void Send3A4()
+{
+   int first = page3A4 * 60;
+   uint64_t bits = first == 0 ? alerts[0] : (alerts[0] >> 60) | (alerts[1] << 4);
+   uint64_t word = (bits << 4) | page3A4;
+   uint32_t data[2] = { (uint32_t)word, (uint32_t)(word >> 32) };
+
+   page3A4 ^= 1;
+   Send(0x3A4, data, 8);
+}
+
+static void Send424()
+{
+   uint32_t data[2] = { pending424, 0 };
+
+   if (pending424 == 0) return;
+
+   if (pending424 == ALERT_CAN_RAT)
+   {
+      Put(data, 16, 3, MIA_RX_ERROR);
+      Put(data, 24, 16, 0x22A);
+   }
+   pending424 = 0;
+   Send(0x424, data, 8);
+}
+
+struct SimFrame
+{
+   uint16_t period;     // ms
+   uint16_t phase;      // ms
+   void (*send)();
+};
+
+// Periods of the PCS frames, phases so they do not all go out in the same millisecond
+static const SimFrame frames[] =
+{
+   { 10,   1,  Send2B4 },
+   { 10,   5,  Send2C4 },
+   { 100,  3,  Send204 },
+   { 100,  7,  Send264 },
+   { 1000, 11, Send2A4 },
+   { 500,  13, Send3A4 },
+   { 1,    0,  Send424 },   // sends only when an alert came up
+};
+
+static void RunStateMachine()
+{
+   bool wantCharge = in.chgBit && in.reqEnable && in.cpEnable && !DigIo::chena_out.Get();
+   bool mia = state != INIT && (in.last22A == 0 || now - in.last22A > MIA_MS);
+   bool overTemp = AlertActive(ALERT_OVERTEMP);
+   bool fault = m.fault != 0 || mia || overTemp;
+   uint32_t elapsed = now - stateSince;
+
+   SetAlert(ALERT_CAN_RAT, mia);
+
+   if (fault && state >= STARTUP && state <= ENABLE)
+   {
+      Enter(FAULTED);
+      return;
+   }
+
+   switch (state)
+   {
+   case INIT:
+      if (elapsed >= T_INIT) Enter(IDLE);
+      break;
+   case IDLE:
+      if (fault) Enter(FAULTED);
+      else if (wantCharge) Enter(STARTUP);
+      break;
+   case STARTUP:
+      if (!wantCharge) Enter(SHUTDOWN);
+      else if (elapsed >= T_STARTUP) Enter(WAIT_AC);
+      break;
+   case WAIT_AC:
+      if (!wantCharge) Enter(SHUTDOWN);
+      else if (AcPresent()) Enter(QUALIFY);
+      break;
+   case QUALIFY:
+      if (!wantCharge) Enter(SHUTDOWN);
+      else if (!AcPresent()) Enter(WAIT_AC);
+      else if (elapsed >= T_QUALIFY) Enter(CONFIG);
+      break;
+   case CONFIG:
+      if (!wantCharge) Enter(SHUTDOWN);
+      else if (elapsed >= T_CONFIG) Enter(ENABLE);
+      break;
+   case ENABLE:
+      if (!wantCharge) Enter(SHUTDOWN);
+      else if (!AcPresent()) Enter(WAIT_AC);
+      break;
+   case SHUTDOWN:
+      if (elapsed >= T_SHUTDOWN) Enter(IDLE);
+      break;
+   case FAULTED:
+      if (!fault && !wantCharge) Enter(CLR_FAULTS);
+      break;
+   case CLR_FAULTS:
+      if (elapsed >= T_CLR_FAULTS) Enter(IDLE);
+      break;
+   default:
+      Enter(INIT);
+      break;
+   }
+}
+
+static void RunPhysics(double dt)
+{
+   int phases = Phases();
+   double hwA = m.hw == 0 ? 48 : m.hw == 1 ? 32 : 16;
+   double lineA = in.pilotA < hwA ? in.pilotA : hwA;
+   double tmax = 0;
+
+   for (int p = 0; p < NUM_PHASES; p++)
+      tmax = m.tphase[p] > tmax ? m.tphase[p] : tmax;
+
+   // Charger
+   double derate = (DERATE_END - tmax) / (DERATE_END - DERATE_START);
+   derate = derate < 0 ? 0 : derate > 1 ? 1 : derate;
+   m.avail = AcPresent() ? m.uline * lineA * phases * derate : 0;
+
+   double target = state == ENABLE ? (in.powerReq < m.avail ? in.powerReq : m.avail) : 0;
+   m.pac = m.pac + AC_SLEW_W_S * dt < target ? m.pac + AC_SLEW_W_S * dt : target;
+   m.pdc = m.pac * CHG_EFF;
+   m.iline = m.uline > 0 ? m.pac / phases / m.uline : 0;
+
+   // DC-DC, works whenever it is enabled, the HV comes from the battery
+   bool dcdcOn = in.dcdcBit && !DigIo::dcdcena_out.Get();
+   double spnt = in.dcdcSpnt < 9 ? 9 : in.dcdcSpnt > 16 ? 16 : in.dcdcSpnt;
+   double ulvTarget = dcdcOn ? spnt : m.lvbat;
+   m.ulv += (ulvTarget - m.ulv) * (dt < ULV_TAU_S ? dt / ULV_TAU_S : 1);
+   m.ilv = dcdcOn ? m.lvload : 0;
+   double plv = m.ulv * m.ilv;
+   double phv = plv / DCDC_EFF;
+
+   // Battery
+   double pbat = m.pdc - phv;
+   m.soc += pbat * dt / 3600 / (m.capacity * 1000);
+   m.soc = m.soc < 0 ? 0 : m.soc > 1 ? 1 : m.soc;
+   double ocv = m.ubatmin + (m.ubatmax - m.ubatmin) * m.soc;
+   m.ubat = ocv + pbat / ocv * RBAT_OHM;
+
+   // Energy counters and heating
+   for (int p = 0; p < NUM_PHASES; p++)
+   {
+      double pp = p < phases ? m.pac / phases : 0;
+      m.ackwh[p] += pp * dt / 3600000;
+      m.tphase[p] += (m.ambient + K_PHASE_C_KW * pp / 1000 - m.tphase[p]) * dt / TAU_PHASE_S;
+   }
+   m.dcdckwh += plv * dt / 3600000;
+   m.tdcdc += (m.ambient + K_DCDC_C_KW * plv / 1000 - m.tdcdc) * dt / TAU_DCDC_S;
+
+   if (tmax > OVERTEMP_ON) SetAlert(ALERT_OVERTEMP, true);
+   if (tmax < OVERTEMP_OFF) SetAlert(ALERT_OVERTEMP, false);
+}
+
+void PcsSim::Init(FrameSink frameSink)
+{
+   memset(&m, 0, sizeof(m));
+   memset(&in, 0, sizeof(in));
+   m.uline = 230;
+   m.grid = 1;
+   m.hw = 0;
+   m.ambient = 25;
+   m.ubatmin = 330;
+   m.ubatmax = 400;
+   m.capacity = 75;
+   m.lvload = 15;
+   m.lvbat = 12.4;
+   m.soc = 0.2;
+   m.ackwh[0] = 1000;
+   m.dcdckwh = 200;
+   m.ulv = m.lvbat;
+   m.ubat = m.ubatmin + (m.ubatmax - m.ubatmin) * m.soc;
+   for (int p = 0; p < NUM_PHASES; p++)
+      m.tphase[p] = m.ambient;
+   m.tdcdc = m.ambient;
+   in.dcdcSpnt = 14;
+
+   sink = frameSink;
+   now = 0;
+   powered = false;
+   alerts[0] = alerts[1] = 0;
+   pending424 = 0;
+   mux2C4 = 0;
+   page3A4 = 0;
+   Enter(INIT);
+}
+
+void PcsSim::Receive(uint32_t id, const uint32_t data[2], uint8_t len)
+{
+   const uint8_t* bytes = (const uint8_t*)data;
+
+   switch (id)
+   {
+   case 0x22A:
+      if (len < 3) break;
+      in.chgBit = (bytes[2] & 0x4) != 0;
+      in.dcdcBit = (bytes[2] & 0x8) != 0;
+      in.last22A = now | 1;
+      break;
+   case 0x2B2:
+      if (len < 3) break;
+      in.powerReq = data[0] & 0xFFFF;
+      in.reqEnable = (bytes[2] & 0x02) != 0;
+      break;
+   case 0x13D:
+   case 0x23D:
+      if (len < 2) break;
+      in.cpEnable = bytes[0] == 0x05;
+      in.pilotA = bytes[1] * 0.5;
+      break;
+   case 0x3A1:
+      if (len < 4) break;
+      in.dcdcSpnt = ((data[0] >> 16) & 0x7FF) * 0.01;
+      break;
+   default:
+      break;
+   }
+}
+
+void PcsSim::Run(uint32_t nowMs)
+{
+   now = nowMs;
+
+   // The PCS is powered through pcsena_out and starts over from INIT every time.
+   // Unpowered it is silent and forgets the controller, but keeps cooling down.
+   if (!DigIo::pcsena_out.Get())
+   {
+      if (powered) memset(&in, 0, sizeof(in));
+      powered = false;
+      Enter(INIT);
+   }
+   else if (!powered)
+   {
+      powered = true;
+      Enter(INIT);
+   }
+
+   if (now % 10 == 0)
+   {
+      if (powered) RunStateMachine();
+      RunPhysics(0.01);
+   }
+   m.chgstat = state;
+
+   if (!powered) return;
+
+   for (unsigned i = 0; i < sizeof(frames) / sizeof(frames[0]); i++)
+   {
+      if (now % frames[i].period == frames[i].phase)
+         frames[i].send();
+   }
+}
+
+bool PcsSim::Set(const char* key, double value)
+{
+   if (strcmp(key, "alert") == 0 || strcmp(key, "clear") == 0)
+   {
+      SetAlert((uint8_t)value, key[0] == 'a');
+      return true;
+   }
+   for (unsigned i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+   {
+      if (keys[i].writable && strcmp(key, keys[i].name) == 0)
+      {
+         *keys[i].value = value;
+         return true;
+      }
+   }
+   return false;
+}
+
+bool PcsSim::Get(const char* key, double& value)
+{
+   for (unsigned i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+   {
+      if (strcmp(key, keys[i].name) == 0)
+      {
+         value = *keys[i].value;
+         return true;
+      }
+   }
+   return false;
+}
@@ -0,0 +1,284 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hoststubs.h"
+#include "pcssim.h"
+#include "chargecontrol.h"
+#include "PCSCan.h"
+#include "params.h"
+#include "busstats.h"
+#include "txsched.h"
+#include "profiler.h"
+#include "timebase.h"
+
+/* Runs the control logic through a scripted session on the host, with the task
+ * timing of the firmware on simulated time. Usage: pcsrun [-q] [-p] [-s] [script]
+ *
+ * The script is read from the file or stdin, one event per line, time in ms:
+ *
+ *    # comment
+ *    100 rx 109 0300009A01B80BAF     frame received, id and payload in hex
+ *    150 set txmingap 2              parameter or value write
+ *    200 print opmode                prints the current value
+ *    300 expect idc 5 7.5            fails the run unless min <= value <= max
+ *    400 sim uline 240               plant setting, see PcsSim
+ *    60000 end                       runs up to that time, then stops
+ *
+ * Prints every sent frame, every change of an output pin and every journal record
+ * with its time in ms, so two builds can be compared with diff. -q leaves out the
+ * frames, -p prints the profiler probes at the end (host time, in us).
+ *
+ * -s closes the loop through the PcsSim plant model: it receives every frame sent
+ * and its frames are received like those from the bus. print and expect also take
+ * the names of the plant variables. */
+
+static bool quiet = false;
+static bool plant = false;
+static int failures = 0;
+
+static uint32_t Now()
+{
+   return Timebase::Millis();
+}
+
+static void PrintTx(uint32_t id, const uint32_t data[2], uint8_t len)
+{
+   const uint8_t* bytes = (const uint8_t*)data;
+
+   if (plant) PcsSim::Receive(id, data, len);
+   if (quiet) return;
+
+   printf("%u tx %03X ", Now(), id);
+   for (int i = 0; i < len; i++)
+      printf("%02X", bytes[i]);
+   printf("\n");
+}
+
+static void PrintPin(const char* name, bool level)
+{
+   printf("%u pin %s %d\n", Now(), name, level);
+}
+
+static void PrintJournal(uint8_t type, uint8_t value)
+{
+   printf("%u journal %u %u\n", Now(), type, value);
+}
+
+// A frame of the plant, handled like CanCallback does
+static void PlantFrame(uint32_t id, uint32_t data[2], uint8_t len)
+{
+   BusStats::CountRx(id, len);
+   ChargeControl::Receive(id, data, len);
+}
+
+// One millisecond of the firmware: the SysTick, the plant frames of that millisecond,
+// then the tasks that are due in the order Ms100Task, Ms10Task, TxSlotTask. The main
+// loop work of Ms100Task follows it right away, as it would on an idle controller.
+static void Step()
+{
+   HostStubs::Advance(1000);
+
+   uint32_t now = Now();
+
+   if (plant) PcsSim::Run(now);
+
+   if (now % 100 == 0)
+   {
+      BusStats::Update();
+      ChargeControl::Run();
+      ChargeControl::DebounceFaults();
+      ChargeControl::PackVcuStatus();
+   }
+   if (now % 10 == 0)
+      ChargeControl::DecodeRxFrames();
+   if (now % TxScheduler::SLOT_MS == 0)
+      TxScheduler::Run(ChargeControl::IsCanEnabled(), Param::GetInt(Param::txmingap));
+}
+
+// Payload in hex, byte 0 first, as candump prints it
+static int ParsePayload(const char* hex, uint32_t data[2])
+{
+   int len = 0;
+
+   data[0] = data[1] = 0;
+   while (len < 8 && hex[0] && hex[1])
+   {
+      char byte[3] = { hex[0], hex[1], 0 };
+      data[len / 4] |= strtoul(byte, 0, 16) << (8 * (len % 4));
+      hex += 2;
+      len++;
+   }
+   return len;
+}
+
+static bool Execute(uint32_t time, const char* cmd, char* arg1, char* arg2, char* arg3, int line)
+{
+   if (strcmp(cmd, "rx") == 0 && arg1 && arg2)
+   {
+      uint32_t data[2];
+      uint8_t len = ParsePayload(arg2, data);
+      uint32_t id = strtoul(arg1, 0, 16);
+
+      BusStats::CountRx(id, len);
+      ChargeControl::Receive(id, data, len);
+   }
+   else if (strcmp(cmd, "sim") == 0 && arg1 && arg2)
+   {
+      if (!plant || !PcsSim::Set(arg1, atof(arg2)))
+      {
+         fprintf(stderr, "line %d: no plant or unknown setting %s\n", line, arg1);
+         return false;
+      }
+   }
+   else if ((strcmp(cmd, "print") == 0 && arg1) || (strcmp(cmd, "expect") == 0 && arg1 && arg2 && arg3))
+   {
+      Param::PARAM_NUM p = Param::NumFromString(arg1);
+      double value;
+
+      if (p != Param::PARAM_INVALID)
+         value = Param::GetFloat(p);
+      else if (!plant || !PcsSim::Get(arg1, value))
+      {
+         fprintf(stderr, "line %d: unknown value %s\n", line, arg1);
+         return false;
+      }
+
+      if (cmd[0] == 'p')
+         printf("%u %s %g\n", time, arg1, value);
+      else if (value < atof(arg2) || value > atof(arg3))
+      {
+         printf("%u FAIL %s %g not in %s..%s\n", time, arg1, value, arg2, arg3);
+         failures++;
+      }
+   }
+   else if (strcmp(cmd, "set") == 0 && arg1 && arg2)
+   {
+      Param::PARAM_NUM p = Param::NumFromString(arg1);
+
+      if (p == Param::PARAM_INVALID)
+      {
+         fprintf(stderr, "line %d: unknown parameter %s\n", line, arg1);
+         return false;
+      }
+      if (Param::GetType(p) != Param::TYPE_PARAM)
+         Param::SetFixed(p, FP_FROMFLT(atof(arg2)));
+      else if (Param::Set(p, FP_FROMFLT(atof(arg2))) != 0)
+      {
+         fprintf(stderr, "line %d: %s out of range\n", line, arg2);
+         return false;
+      }
+   }
+   else if (strcmp(cmd, "end") != 0)
+   {
+      fprintf(stderr, "line %d: cannot parse\n", line);
+      return false;
+   }
+   return true;
+}
+
+static void PrintProfile()
+{
+   printf("probe count mean_us max_us\n");
+   for (int p = 0; p < Profiler::PRB_LAST; p++)
+   {
+      const char* name = Profiler::GetName(p);
+      uint32_t count = Profiler::Get(p, Profiler::STAT_COUNT);
+
+      if (count == 0) continue;
+
+      if (name)
+         printf("%s", name);
+      else
+         printf("tx%03X", TxScheduler::GetId(p - Profiler::PRB_TX0));
+      printf(" %u %.3f %.3f\n", count,
+             Profiler::Get(p, Profiler::STAT_MEAN) / (float)Profiler::CYCLES_PER_US,
+             Profiler::Get(p, Profiler::STAT_MAX) / (float)Profiler::CYCLES_PER_US);
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   bool profile = false;
+   FILE* script = stdin;
+   char buf[256];
+   int line = 0;
+
+   for (int i = 1; i < argc; i++)
+   {
+      if (strcmp(argv[i], "-q") == 0)
+         quiet = true;
+      else if (strcmp(argv[i], "-p") == 0)
+         profile = true;
+      else if (strcmp(argv[i], "-s") == 0)
+         plant = true;
+      else if ((script = fopen(argv[i], "r")) == 0)
+      {
+         perror(argv[i]);
+         return 1;
+      }
+   }
+
+   Param::LoadDefaults();
+   Param::SetInt(Param::version, 4);
+   BusStats::Init();
+   Profiler::Init();
+   TxScheduler::Init(ChargeControl::GetTxSlots(), ChargeControl::GetTxSlotCount());
+   HostStubs::SetCanSink(PrintTx);
+   HostStubs::SetPinSink(PrintPin);
+   HostStubs::SetJournalSink(PrintJournal);
+   PcsSim::Init(PlantFrame);
+
+   while (fgets(buf, sizeof(buf), script))
+   {
+      char* time = strtok(buf, " \t\r\n");
+      char* cmd = strtok(0, " \t\r\n");
+      char* arg1 = strtok(0, " \t\r\n");
+      char* arg2 = strtok(0, " \t\r\n");
+      char* arg3 = strtok(0, " \t\r\n");
+      uint32_t t;
+
+      line++;
+      if (time == 0 || time[0] == '#') continue;
+
+      t = strtoul(time, 0, 10);
+      if (cmd == 0 || t < Now())
+      {
+         fprintf(stderr, "line %d: missing command or time going backwards\n", line);
+         return 1;
+      }
+
+      while (Now() < t)
+         Step();
+
+      if (!Execute(t, cmd, arg1, arg2, arg3, line))
+         return 1;
+      if (strcmp(cmd, "end") == 0)
+         break;
+   }
+
+   fprintf(stderr, "%u ms, %u frames sent, %u pin changes, %u journal records, %d failed checks\n",
+           Now(), HostStubs::GetTxFrames(), HostStubs::GetPinChanges(), HostStubs::GetJournalRecords(), failures);
+   if (profile)
+      PrintProfile();
+
+   return failures > 0 ? 2 : 0;
+}
@@ -26,43 +26,80 @@
 #include "params.h"
 #include "digio.h"
 
+// Control inputs read once at the start of a task tick. Everything in the tick works
+// from the same copy, so a VCU request or terminal write cannot change them halfway.
+struct ControlInputs
+{
+    uint8_t opmode;
+    uint8_t activate;      // devicesOn
+    uint8_t chgStat;       // chargerStates
+    bool chargerEnable;
+    bool usInlet;          // modelcode
+    uint8_t iaclim;        // A
+    uint8_t pilotLim;      // iaclim in 0.5A steps as sent in 0x13D/0x21D/0x23D
+    uint16_t pacspnt;      // W
+    uint16_t udcspnt;      // V
+    uint16_t dcdcSpnt;     // udcdc in 0.01V steps as sent in 0x3A1
+};
+
+// Groups of ControlInputs fields, a TX slot lists the ones its frame is sent on change of
+enum InputChange
+{
+    IN_ACTIVATE = 1,       // activate
+    IN_CHGENABLE = 2,      // chargerEnable
+    IN_CURRENT = 4,        // iaclim, pilotLim
+};
+
 class PCSCan
 {
 public:
-    static void Msg13D();
-    static void Msg20A();
-    static void Msg221();
-    static void Msg2D1();
-    static void Msg212();
-    static void Msg21D();
-    static void Msg22A();
-    static void Msg232();
-    static void Msg23D();
-    static void Msg25D();
-    static void Msg2B2(uint16_t Charger_Power);
-    static void Msg321();
-    static void Msg333();
-    static void Msg3A1();
-    static void Msg3B2();
-    static void Msg545();
+    static ControlInputs CaptureInputs();
+    /** InputChange bits of the fields that differ between a and b */
+    static uint8_t ChangedInputs(const ControlInputs& a, const ControlInputs& b);
+
+    // All builders share one signature so TxScheduler can call them from its table,
+    // the ones sending constant frames ignore the inputs. They return true if they sent a frame.
+    static bool Msg13D(const ControlInputs& in);
+    static bool Msg20A(const ControlInputs&);
+    static bool Msg221(const ControlInputs&);
+    static bool Msg2D1(const ControlInputs&);
+    static bool Msg212(const ControlInputs&);
+    static bool Msg21D(const ControlInputs& in);
+    static bool Msg22A(const ControlInputs& in);
+    static bool Msg232(const ControlInputs&);
+    static bool Msg23D(const ControlInputs& in);
+    static bool Msg25D(const ControlInputs& in);
+    static void Msg2B2(const ControlInputs& in, uint16_t Charger_Power);
+    static bool Msg321(const ControlInputs&);
+    static bool Msg333(const ControlInputs&);
+    static bool Msg3A1(const ControlInputs& in);
+    static bool Msg3B2(const ControlInputs&);
+    static bool Msg545(const ControlInputs&);
+
+    // Packed state frames for passive loggers on canlogid + LogFrame. TxScheduler calls
+    // them every LOG_PERIOD_MS, each one sends when enabled in canlogen and its
+    // canlogfast/canlogslow interval has elapsed.
+    enum LogFrame { LOG_HV, LOG_LV, LOG_TEMP, LOG_ENERGY, LOG_LAST };
+    enum { LOG_PERIOD_MS = 10 };
+    static bool MsgLogHv(const ControlInputs&);
+    static bool MsgLogLv(const ControlInputs&);
+    static bool MsgLogTemp(const ControlInputs&);
+    static bool MsgLogEnergy(const ControlInputs&);
 
     static void handle204(uint32_t data[2]);
     static void handle2B4(uint32_t data[2]);
     static void handle264(uint32_t data[2]);
     static void handle2A4(uint32_t data[2]);
     static void handle2C4(uint32_t data[2]);
-    static void handle3A4(uint32_t data[2]);
+    static void handle3A4(uint32_t data[2], uint32_t time);
     static void handle424(uint32_t data[2]);
     static void handle504(uint32_t data[2]);
     static void handle76C(uint32_t data[2]);
-    static void AlertHandler();
 
 private:
 
 };
 
-static uint8_t CalcPCSChecksum(uint8_t *data, uint16_t id);
-static int16_t ProcessTemps(uint16_t InVal);
 static void ProcessCANRat(uint16_t AlertCANId,uint8_t AlertRxError);
 
 #endif /* PCSCan_h */
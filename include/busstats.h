@@ -0,0 +1,75 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUSSTATS_H_INCLUDED
+#define BUSSTATS_H_INCLUDED
+
+#include <stdint.h>
+
+/* Per-ID CAN traffic accounting and bus load.
+ *
+ * Every frame seen by CanCallback and every frame we send ourselves is counted with its
+ * length on the wire: the fixed 11-bit ID frame fields plus the worst case number of
+ * stuff bits for its DLC, looked up from a table so the count stays cheap in the RX
+ * interrupt. Real frames carry fewer stuff bits, so the load of the frames seen is an
+ * upper bound, e.g. a full 8 byte frame is counted as 135 bits, at least 111 without
+ * stuffing. Frames dropped by the acceptance filters and those sent by libopeninv itself
+ * (SDO replies, CAN map) are not seen at all, they can make up for that on a shared bus.
+ *
+ * Update() runs every 100ms and publishes the load of the last second and the TOP_N
+ * IDs with the highest share of it. */
+class BusStats
+{
+public:
+   enum { TABLE_SIZE = 64, TOP_N = 3, BITRATE = 500000 };
+
+   struct Entry
+   {
+      uint16_t id;          // EMPTY_ID when unused
+      uint32_t rxFrames;
+      uint32_t txFrames;
+      uint32_t rxBits;
+      uint32_t txBits;
+      uint32_t windowBits;  // bits in the running second
+      uint32_t lastBits;    // bits in the last complete second
+   };
+
+   static const uint16_t EMPTY_ID = 0xFFFF;
+
+   /** Marks all table entries free, call before CAN is set up */
+   static void Init();
+   static void CountRx(uint32_t id, uint8_t dlc);
+   static void CountTx(uint32_t id, uint8_t dlc);
+   /** Call every 100ms, publishes busload and the top talkers */
+   static void Update();
+   static const Entry& GetEntry(int i) { return table[i]; }
+   static uint32_t GetUntracked() { return untracked; }
+   /** Bits of a standard data frame including worst case stuff bits and interframe space */
+   static uint32_t FrameBits(uint8_t dlc);
+
+private:
+   static Entry* Lookup(uint32_t id);
+
+   static Entry table[TABLE_SIZE];
+   static uint32_t windowBits[10];   // per 100ms, last second
+   static uint8_t window;
+   static uint32_t untracked;        // frames that found the table full
+};
+
+#endif // BUSSTATS_H_INCLUDED
@@ -0,0 +1,51 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CANFILTER_H_INCLUDED
+#define CANFILTER_H_INCLUDED
+
+#include <stdint.h>
+
+/* Plans and programs bxCAN acceptance filter banks for a fixed set of 11-bit IDs.
+ *
+ * IDs that differ in single bits are merged into exact id/mask pairs, so a mask filter
+ * never accepts an ID that was not asked for. Two pairs fit a 16-bit mask bank, the
+ * remaining single IDs go four to a 16-bit list bank. Each call routes all its IDs to
+ * one receive FIFO.
+ *
+ * libopeninv fills banks from 0 upwards for RegisterUserMessage() and CanMap, so we
+ * allocate from the top bank downwards to stay clear of it. */
+class CanFilter
+{
+public:
+   enum { TOP_BANK = 13, MAX_IDS = 16 };
+
+   struct Bank
+   {
+      bool isMask;
+      uint16_t reg[4]; // list: 4 ids, mask: id, mask, id, mask in filter register layout
+   };
+
+   /** Packs ids into as few banks as possible, returns the number of banks or -1 when maxBanks is too small */
+   static int Plan(const uint16_t* ids, int count, Bank* banks, int maxBanks);
+   /** Programs the planned banks below firstBank for the given fifo, returns the next free bank number */
+   static int Apply(const uint16_t* ids, int count, uint32_t fifo, int firstBank);
+};
+
+#endif // CANFILTER_H_INCLUDED
@@ -0,0 +1,95 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CANRXRING_H_INCLUDED
+#define CANRXRING_H_INCLUDED
+
+#include <stdint.h>
+
+struct CanRxFrame
+{
+   uint32_t time;    // Timebase::Millis() at reception
+   uint32_t micros;  // Timebase::Micros() at reception, for latency measurements
+   uint16_t id;
+   uint8_t dlc;
+   uint8_t reserved;
+   uint32_t data[2];
+};
+
+/* Single producer (CAN RX interrupt), single consumer (scheduler task) frame queue.
+ * Each side only ever writes its own index, so no interrupt locking is needed; the
+ * acquire/release accesses order the slot copy against publishing the index.
+ * Size must be a power of two, one slot is kept free to tell full from empty. */
+template <uint16_t Size>
+class CanRxRing
+{
+public:
+   static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "ring size must be a power of two");
+
+   CanRxRing() : head(0), tail(0), highWater(0), drops(0) {}
+
+   /** Producer side. Returns false and counts a drop when the ring is full */
+   bool Push(uint32_t id, const uint32_t data[2], uint8_t dlc, uint32_t time, uint32_t micros)
+   {
+      uint16_t h = head;
+      uint16_t used = (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) & (Size - 1);
+
+      if (used == Size - 1)
+      {
+         drops++;
+         return false;
+      }
+
+      CanRxFrame& f = frames[h];
+      f.time = time;
+      f.micros = micros;
+      f.id = id;
+      f.dlc = dlc;
+      f.data[0] = data[0];
+      f.data[1] = data[1];
+      __atomic_store_n(&head, (h + 1) & (Size - 1), __ATOMIC_RELEASE);
+
+      if (used + 1 > highWater) highWater = used + 1;
+      return true;
+   }
+
+   /** Consumer side. Copies the oldest frame into f, returns false when empty */
+   bool Pop(CanRxFrame& f)
+   {
+      uint16_t t = tail;
+
+      if (t == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return false;
+
+      f = frames[t];
+      __atomic_store_n(&tail, (t + 1) & (Size - 1), __ATOMIC_RELEASE);
+      return true;
+   }
+
+   uint16_t GetHighWater() const { return highWater; }
+   uint32_t GetDrops() const { return drops; }
+
+private:
+   CanRxFrame frames[Size];
+   uint16_t head; // written by producer only
+   uint16_t tail; // written by consumer only
+   volatile uint16_t highWater;
+   volatile uint32_t drops;
+};
+
+#endif // CANRXRING_H_INCLUDED
@@ -0,0 +1,54 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CHANGELOG_H_INCLUDED
+#define CHANGELOG_H_INCLUDED
+
+#include <stdint.h>
+#include "params.h"
+
+/* Change sequence numbers for all parameters and values, so a client can ask for the
+ * entries changed since its last poll instead of reading all of them.
+ *
+ * libopeninv keeps no per-entry state to hook into, so changes are found by comparison:
+ * Scan() compares every entry with its copy from the previous scan and gives all entries
+ * that differ the next sequence number. Every query scans first, so its answer is
+ * current. A value that changes and changes back between two scans is not reported,
+ * the client already holds that value.
+ *
+ * The sequence starts at the journal boot number << 16 on every power up, with all
+ * entries marked changed there. A client still holding a number from an earlier boot
+ * or one past the current sequence is therefore sent everything. */
+class ChangeLog
+{
+public:
+   static void Init(uint16_t boot);
+   /** Numbers the entries changed since the previous scan, returns the current sequence. Main loop only */
+   static uint32_t Scan();
+   static bool ChangedSince(Param::PARAM_NUM p, uint32_t since) { return changed[p] > since || since > sequence; }
+   static uint32_t GetSequence() { return sequence; }
+
+private:
+   static s32fp last[Param::PARAM_LAST];
+   static uint32_t changed[Param::PARAM_LAST];
+   static uint32_t sequence;
+};
+
+#endif // CHANGELOG_H_INCLUDED
@@ -0,0 +1,59 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CHARGECONTROL_H_INCLUDED
+#define CHARGECONTROL_H_INCLUDED
+
+#include <stdint.h>
+#include "txsched.h"
+
+/* The charge control proper: decoding of the PCS and VCU frames, the charger state
+ * machine, the 0x2B2 power ramp, the VCU status frame 0x108 and the table of everything
+ * we send periodically.
+ *
+ * None of this touches the hardware other than through Stm32Can, DigIo and the RTC
+ * counter, main.cpp owns the peripherals, the scheduler and the CAN filters and calls
+ * in from its tasks. That keeps the module buildable against the stubs of "make host".
+ *
+ *    Receive()          CAN RX interrupt
+ *    DecodeRxFrames()   start of Ms10Task
+ *    Run()              Ms100Task
+ *    DebounceFaults(),
+ *    PackVcuStatus()    main loop, posted by Ms100Task */
+class ChargeControl
+{
+public:
+   /** Queues a PCS or VCU frame for DecodeRxFrames(), returns false for any other id */
+   static bool Receive(uint32_t id, uint32_t data[2], uint8_t dlc);
+   /** Runs every queued frame through its decoder */
+   static void DecodeRxFrames();
+   /** State machine and PCS liveness, call every 100ms */
+   static void Run();
+   /** Sustained zero-output conditions for the VCU status bits */
+   static void DebounceFaults();
+   /** Packs the 0x108 payload */
+   static void PackVcuStatus();
+   /** False while the PCS frames must stay off the bus */
+   static bool IsCanEnabled();
+   static const TxSlot* GetTxSlots();
+   static int GetTxSlotCount();
+};
+
+#endif // CHARGECONTROL_H_INCLUDED
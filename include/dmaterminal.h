@@ -0,0 +1,58 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DMATERMINAL_H_INCLUDED
+#define DMATERMINAL_H_INCLUDED
+
+#include <stdint.h>
+#include "terminal.h"
+
+/* Terminal whose output goes through a ring buffer drained by DMA instead of
+ * Terminal's own double buffer, which waits for the UART before every refill.
+ *
+ * PutChar() only copies into the ring. Whenever the DMA is idle, Flush() hands it the
+ * next contiguous part of the ring. Flush() is called by PutChar() and by the main loop,
+ * so the tail of an output still goes out while nothing prints. Only when a command prints
+ * more than the ring holds, like "json", does PutChar() have to wait for the UART. It
+ * then calls the yield function, so SDO requests and deferred work are served during the
+ * dump instead of after it.
+ *
+ * Input is still read by Terminal::Run() from its DMA ring, which also serves
+ * KeyPressed() for the "stream" command. */
+class DmaTerminal : public Terminal
+{
+public:
+   enum { RING_SIZE = 1024 };
+
+   DmaTerminal(uint32_t usart, const TERM_CMD* commands);
+   void PutChar(char c);
+   /** Starts the next transfer if the DMA is idle, main loop only */
+   void Flush();
+   void SetYield(void (*fn)(void)) { yield = fn; }
+
+private:
+   char ring[RING_SIZE];
+   uint16_t head;        // next free byte
+   uint16_t tail;        // oldest byte not yet sent
+   uint16_t inFlight;    // length of the running transfer
+   bool yielding;
+   void (*yield)(void);
+};
+
+#endif // DMATERMINAL_H_INCLUDED
@@ -10,5 +10,15 @@
 #define PARAM_BLKNUM  1   //last block of 1k
 #define CAN1_BLKNUM   2
 #define CAN2_BLKNUM   4
+#define JOURNAL_BLKNUM  5 //first of JOURNAL_NUMBLKS blocks below CAN2
+#define JOURNAL_NUMBLKS 8
+
+//Binary telemetry output, TX only on PA9
+#define TLM_USART       USART1
+#define TLM_BAUD        921600
+#define TLM_DMA_CHANNEL DMA_CHANNEL4 //USART1_TX
+
+//Terminal output, USART3
+#define TERM_DMA_CHANNEL DMA_CHANNEL2 //USART3_TX
 
 #endif // HWDEFS_H_INCLUDED
@@ -30,7 +30,9 @@ void clock_setup(void);
 void nvic_setup(void);
 void nvic_can_setup(void);
 void rtc_setup(void);
+void systick_setup(void);
 void tim_setup(void);
+void tlm_usart_setup(void);
 void write_bootloader_pininit();
 
 #ifdef __cplusplus
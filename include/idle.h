@@ -0,0 +1,55 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDLE_H_INCLUDED
+#define IDLE_H_INCLUDED
+
+#include <stdint.h>
+#include "my_fp.h"
+
+/* CPU load from the time the main loop has nothing to do.
+ *
+ * Calibrate() measures with the cycle counter how long one main loop pass takes when
+ * there is no work. Run() executes one pass, and when it reports no work the core
+ * sleeps in WFI until the next interrupt, at the latest the 1ms SysTick. The sleep is
+ * timed with the SysTick counter, which keeps running in sleep mode, while interrupts
+ * are masked, so the interrupt that woke us is not counted as idle. Each idle pass adds
+ * its calibrated cost plus the sleep to the idle cycles, Update() turns the idle cycles
+ * of the last 100ms into a load percentage.
+ *
+ * Work posted between the end of a pass and the WFI waits for the next SysTick. */
+class Idle
+{
+public:
+   typedef bool (*Pass)(void);   // returns true when it did some work
+
+   /** Call with the pass the main loop will run, before the scheduler starts */
+   static void Calibrate(Pass pass);
+   static void Run(Pass pass);
+   /** Call every 100ms, returns the load of the last 100ms in % */
+   static s32fp Update();
+   static uint32_t GetPassCycles() { return passCycles; }
+
+private:
+   static uint32_t passCycles;
+   static volatile uint32_t idleCycles;
+   static uint32_t lastIdle;
+};
+
+#endif // IDLE_H_INCLUDED
@@ -0,0 +1,90 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JOURNAL_H_INCLUDED
+#define JOURNAL_H_INCLUDED
+
+#include <stdint.h>
+
+/* Append-only event journal in the JOURNAL_NUMBLKS flash pages below the CAN2 block.
+ *
+ * Each page starts with a header carrying a sequence number, followed by 8 byte records.
+ * Records are only ever programmed into erased slots, a page is erased only when the
+ * journal wraps around to it, so the pages wear evenly.
+ *
+ * On this part a flash erase stalls every instruction fetch for ~20ms, including those of
+ * the scheduler interrupt. Log() therefore only queues the record in RAM, Run() programs
+ * it from the main loop, and the page after the current one is kept erased ahead of time.
+ * That erase is issued from Init() or while Run() is told the charger is idle. When a page
+ * fills during a long session, IsBlocked() turns true and the caller may allow a single
+ * erase at a time it picks, records are queued until then and dropped once the queue is full. */
+class Journal
+{
+public:
+   enum RecordType
+   {
+      REC_BOOT = 1,     // value unused, starts a new boot number
+      REC_ALERT_ON,     // value = PCS alert id
+      REC_ALERT_OFF,    // value = PCS alert id
+      REC_CHG_STAT,     // value = new chargerStates
+      REC_VCU_FAULT,    // value = fault bits as sent in byte 1 bits 4..6 of 0x108, shifted down
+      REC_EMPTY = 0xFF
+   };
+
+   struct Record
+   {
+      uint8_t type;
+      uint8_t value;
+      uint16_t boot;    // power cycle count
+      uint32_t time;    // ms since that power up
+   };
+
+   /** Finds the write position and logs a boot record, call before the scheduler starts */
+   static void Init();
+   /** Queues a record, safe to call from the scheduler tasks and the main loop */
+   static void Log(RecordType type, uint8_t value);
+   /** Programs queued records and, when eraseAllowed, prepares the next page. Main loop only */
+   static void Run(bool eraseAllowed);
+   /** Oldest record in flash or 0 */
+   static const Record* First();
+   /** Record following r or 0 */
+   static const Record* Next(const Record* r);
+   static uint32_t GetDrops() { return drops; }
+   static bool HasPending() { return head != tail; }
+   /** True when the current page is full and records wait for the next page to be erased */
+   static bool IsBlocked();
+   static uint16_t GetBoot() { return boot; }
+
+private:
+   enum { QUEUE_SIZE = 16 };
+
+   static void StartPage(int page, uint32_t seq);
+   static bool Program(const Record& r);
+
+   static Record queue[QUEUE_SIZE];
+   static volatile uint8_t head, tail;
+   static uint32_t drops;
+   static int curPage;
+   static int writeSlot;
+   static uint32_t curSeq;
+   static uint16_t boot;
+   static bool nextErased;
+};
+
+#endif // JOURNAL_H_INCLUDED
@@ -0,0 +1,61 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCY_H_INCLUDED
+#define LATENCY_H_INCLUDED
+
+#include <stdint.h>
+#include "params.h"
+
+/* Min/avg/max of a latency in us, published to three consecutive values
+ * (first = min, first + 1 = avg, first + 2 = max) on every sample. */
+class LatencyStat
+{
+public:
+   constexpr LatencyStat(Param::PARAM_NUM first) : first(first), min(0xFFFFFFFF), max(0), sum(0), count(0) {}
+
+   void Add(uint32_t us)
+   {
+      if (us < min) min = us;
+      if (us > max) max = us;
+
+      // Halve the history instead of overflowing, the average stays valid
+      if (sum + us < sum || count == 0xFFFF)
+      {
+         uint32_t avg = sum / count;
+         count /= 2;
+         sum = avg * count;
+      }
+      sum += us;
+      count++;
+
+      Param::SetInt(first, min);
+      Param::SetInt((Param::PARAM_NUM)(first + 1), sum / count);
+      Param::SetInt((Param::PARAM_NUM)(first + 2), max);
+   }
+
+private:
+   Param::PARAM_NUM first;
+   uint32_t min;
+   uint32_t max;
+   uint32_t sum;
+   uint16_t count;
+};
+
+#endif // LATENCY_H_INCLUDED
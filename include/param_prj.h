@@ -46,8 +46,8 @@
    2. Temporary parameters (id = 0)
    3. Display values
  */
-//Next param id (increase when adding new parameter!): 11
-//Next value Id: 2038
+//Next param id (increase when adding new parameter!): 17
+//Next value Id: 2067
 /*              category     name         unit       min     max     default id */
 #define PARAM_LIST \
    PARAM_ENTRY(CAT_CHARGER, timelim,     "minutes", -1,     10000,  -1,     4   ) \
@@ -56,6 +56,12 @@
    PARAM_ENTRY(CAT_DCDC,    udcdc,       "V",       12,     15,     14,     7  ) \
    PARAM_ENTRY(CAT_GEN,     AlertLog,    OFFON,     0,      1,      1,      9  ) \
    PARAM_ENTRY(CAT_COMM,    nodeid,      "",        1,      63,     49,     10  ) \
+   PARAM_ENTRY(CAT_COMM,    txmingap,    "ms",      0,      50,     4,      11  ) \
+   PARAM_ENTRY(CAT_COMM,    tlmrate,     "ms",      0,      1000,   0,      12  ) \
+   PARAM_ENTRY(CAT_COMM,    canlogid,    "",        0,      2044,   1008,   13  ) \
+   PARAM_ENTRY(CAT_COMM,    canlogen,    LOGFRMS,   0,      15,     0,      14  ) \
+   PARAM_ENTRY(CAT_COMM,    canlogfast,  "ms",      10,     1000,   10,     15  ) \
+   PARAM_ENTRY(CAT_COMM,    canlogslow,  "ms",      10,     1000,   100,    16  ) \
    VALUE_ENTRY(version,     VERSTR,    2000) \
    VALUE_ENTRY(opmode,      OPMODES,   2001) \
    VALUE_ENTRY(chargerEnable,OFFON,    2002) \
@@ -97,6 +103,32 @@
    VALUE_ENTRY(lasterr,errorListString,2028) \
    VALUE_ENTRY(uptime,      "s",       2029) \
    VALUE_ENTRY(cpuload,     "%",       2030) \
+   VALUE_ENTRY(tickmax,     "us",      2061) \
+   VALUE_ENTRY(busload,     "%",       2048) \
+   VALUE_ENTRY(busid1,      "dig",     2049) \
+   VALUE_ENTRY(busld1,      "%",       2050) \
+   VALUE_ENTRY(busid2,      "dig",     2051) \
+   VALUE_ENTRY(busld2,      "%",       2052) \
+   VALUE_ENTRY(busid3,      "dig",     2053) \
+   VALUE_ENTRY(busld3,      "%",       2054) \
+   VALUE_ENTRY(canrxhw,     "dig",     2041) \
+   VALUE_ENTRY(canrxdrop,   "dig",     2042) \
+   VALUE_ENTRY(canfull0,    "dig",     2043) \
+   VALUE_ENTRY(canfull1,    "dig",     2044) \
+   VALUE_ENTRY(pubavoided,  "1/s",     2045) \
+   VALUE_ENTRY(jrnldrop,    "dig",     2046) \
+   VALUE_ENTRY(cantxhw,     "dig",     2047) \
+   VALUE_ENTRY(lattxmin,    "us",      2055) \
+   VALUE_ENTRY(lattxavg,    "us",      2056) \
+   VALUE_ENTRY(lattxmax,    "us",      2057) \
+   VALUE_ENTRY(latiomin,    "us",      2058) \
+   VALUE_ENTRY(latioavg,    "us",      2059) \
+   VALUE_ENTRY(latiomax,    "us",      2060) \
+   VALUE_ENTRY(wqoverrun,   "dig",     2062) \
+   VALUE_ENTRY(tlmdrop,     "dig",     2063) \
+   VALUE_ENTRY(sdolatmin,   "us",      2064) \
+   VALUE_ENTRY(sdolatavg,   "us",      2065) \
+   VALUE_ENTRY(sdolatmax,   "us",      2066) \
 
 
 
@@ -110,6 +142,7 @@
 #define GCFG         "0=None, 1=1P, 2=3P, 3=3PD"
 #define STATES       "0=Off, 1=WaitStart, 2=Enable, 3=Activate, 4=Run, 5=Stop, 6=DRIVE"
 #define INPUTS       "0=Type2, 2=Type1, 3=Manual"
+#define LOGFRMS      "1=HV, 2=LV, 4=Temp, 8=Energy"
 #define POLARITIES   "0=ActiveHigh, 1=ActiveLow"
 #define CAT_TEST     "Testing"
 #define CAT_CHARGER  "Charger"
@@ -0,0 +1,59 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCSALERTS_H_INCLUDED
+#define PCSALERTS_H_INCLUDED
+
+#include <stdint.h>
+
+struct AlertEvent
+{
+   uint32_t time;    // Timebase::Millis() of the 0x3A4 frame that showed the change
+   uint8_t id;       // PCS alert id, 1..102
+   bool onset;       // true when the alert became active, false when it cleared
+};
+
+/* Live set of active PCS alerts from the 0x3A4 alert matrix, kept as a packed 128-bit set
+ * (bit id-1 for alert id). Each matrix page is merged with 64-bit operations, the group
+ * values PCSAlerts1..4 and PCSAlertCnt are only recomputed when a page changed something.
+ * Every onset and clear goes into a small event log so the order of alerts during a
+ * fault can be read back over the terminal ("alerts") and SDO. */
+class PcsAlerts
+{
+public:
+   enum { NUM_ALERTS = 102, LOG_SIZE = 32 };
+
+   /** Merges one matrix page (frame payload) received at time */
+   static void UpdatePage(uint8_t page, const uint32_t data[2], uint32_t time);
+   static bool IsActive(uint8_t id);
+   /** Number of events logged since startup, including those already overwritten */
+   static uint32_t GetEventCount() { return eventCount; }
+   /** Copies the event age steps back from the newest (0 = newest), false when it is not in the log */
+   static bool GetEvent(uint32_t age, AlertEvent& e);
+
+private:
+   static void LogEvent(uint8_t id, bool onset, uint32_t time);
+   static void PublishGroups();
+
+   static uint64_t active[2];
+   static AlertEvent events[LOG_SIZE];
+   static volatile uint32_t eventCount;
+};
+
+#endif // PCSALERTS_H_INCLUDED
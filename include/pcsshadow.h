@@ -0,0 +1,92 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCSSHADOW_H_INCLUDED
+#define PCSSHADOW_H_INCLUDED
+
+#include <stdint.h>
+#include "params.h"
+
+// Values decoded from PCS frames. Each entry names the Param value it is published to.
+#define PCS_SHADOW_LIST \
+   SHADOW_ENTRY(PCS_Type)   \
+   SHADOW_ENTRY(hwaclim)    \
+   SHADOW_ENTRY(CHG_STAT)   \
+   SHADOW_ENTRY(CHGPAvail)  \
+   SHADOW_ENTRY(GridCFG)    \
+   SHADOW_ENTRY(ulv)        \
+   SHADOW_ENTRY(idcdc)      \
+   SHADOW_ENTRY(powerdcdc)  \
+   SHADOW_ENTRY(powerac)    \
+   SHADOW_ENTRY(uac)        \
+   SHADOW_ENTRY(iac)        \
+   SHADOW_ENTRY(ChgACLim)   \
+   SHADOW_ENTRY(ChgATemp)   \
+   SHADOW_ENTRY(ChgBTemp)   \
+   SHADOW_ENTRY(ChgCTemp)   \
+   SHADOW_ENTRY(DCDCTemp)   \
+   SHADOW_ENTRY(DCDCBTemp)  \
+   SHADOW_ENTRY(PCSAmbTemp) \
+   SHADOW_ENTRY(udc)        \
+   SHADOW_ENTRY(idc)        \
+   SHADOW_ENTRY(PCSAcKWh)   \
+   SHADOW_ENTRY(PCSDcdcKWh) \
+   SHADOW_ENTRY(PCSBattKWh) \
+   SHADOW_ENTRY(PCSBoot)    \
+   SHADOW_ENTRY(PCSAlerts1) \
+   SHADOW_ENTRY(PCSAlerts2) \
+   SHADOW_ENTRY(PCSAlerts3) \
+   SHADOW_ENTRY(PCSAlerts4) \
+   SHADOW_ENTRY(PCSAlertCnt)
+
+/* Shadow copy of the decoded PCS state. The frame handlers write here only, a field is
+ * marked dirty when its value actually changes. Publish() runs once per decode pass and
+ * pushes just the dirty fields into Param, so a signal repeated by every mux of 0x2C4
+ * costs one compare instead of a parameter write. */
+class PcsShadow
+{
+public:
+   #define SHADOW_ENTRY(name) name,
+   enum Field { PCS_SHADOW_LIST NUM_FIELDS };
+   #undef SHADOW_ENTRY
+
+   static void Set(Field f, s32fp value)
+   {
+      writes++;
+      if (values[f] != value)
+      {
+         values[f] = value;
+         dirty |= 1u << f;
+      }
+   }
+
+   static void SetInt(Field f, int value) { Set(f, FP_FROMINT(value)); }
+
+   /** Pushes all changed fields into Param and updates the pubavoided value once per second */
+   static void Publish();
+
+private:
+   static s32fp values[NUM_FIELDS];
+   static uint32_t dirty;
+   static uint32_t writes;
+   static uint32_t avoided;
+   static uint32_t windowStart;
+};
+
+#endif // PCSSHADOW_H_INCLUDED
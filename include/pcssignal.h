@@ -0,0 +1,110 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PCSSIGNAL_H_INCLUDED
+#define PCSSIGNAL_H_INCLUDED
+
+#include <stdint.h>
+#include "my_fp.h"
+
+/* Compile-time description of a signal in an 8-byte CAN payload, written the way the DBC
+ * lists it: start bit, length, byte order, signedness, scale and offset. The scale is a
+ * fraction Num/Den because C++11 does not allow float template arguments.
+ *
+ * Every property is a template argument, so each accessor folds to the few shift/mask
+ * instructions for the payload word(s) the signal actually touches, e.g.
+ *
+ *    typedef CanSignal<24, 12, SIG_INTEL, false, 1, 10> DcdcCurrent; // 24|12@1+ (0.1,0)
+ *    Param::SetFixed(Param::idcdc, DcdcCurrent::Fixed(data));
+ *
+ * Fixed() scales in integer arithmetic straight to the s32fp format of the parameter
+ * module, so decoding never touches the soft-float library. Phys() is kept for code
+ * that really wants a float.
+ *
+ * The payload is passed as the two words handed to CanCallback (byte 0 is the LSB of data[0]).
+ * For Intel signals Start is the LSB, for Motorola signals it is the MSB in DBC numbering.
+ */
+
+enum SignalOrder
+{
+   SIG_INTEL = 0,    // little endian, DBC "@1"
+   SIG_MOTOROLA      // big endian, DBC "@0"
+};
+
+template <uint8_t Start, uint8_t Len, SignalOrder Order = SIG_INTEL, bool Signed = false,
+          int32_t Num = 1, int32_t Den = 1, int32_t Offset = 0>
+struct CanSignal
+{
+   static_assert(Len > 0 && Len <= 32, "signal must be 1..32 bits wide");
+   static_assert(Start < 64, "start bit outside of an 8-byte payload");
+   static_assert(Den != 0, "scale denominator must not be zero");
+   static_assert(Order == SIG_INTEL || (7 - Start / 8) * 8 + Start % 8 >= Len - 1,
+                 "Motorola signal runs past the end of the payload");
+   static_assert(Order == SIG_MOTOROLA || Start + Len <= 64, "Intel signal runs past the end of the payload");
+
+   static const uint32_t Mask = 0xFFFFFFFFu >> (32 - Len);
+
+   /** Unsigned raw bits of the signal */
+   static inline uint32_t Raw(const uint32_t data[2])
+   {
+      return Order == SIG_INTEL ? IntelRaw(data) : MotorolaRaw(data);
+   }
+
+   /** Raw bits sign-extended when the signal is signed */
+   static inline int32_t Value(const uint32_t data[2])
+   {
+      return Signed ? (int32_t)(Raw(data) << (32 - Len)) >> (32 - Len) : (int32_t)Raw(data);
+   }
+
+   /** Scaled physical value as fixed point */
+   static inline s32fp Fixed(const uint32_t data[2])
+   {
+      static_assert((uint64_t)Mask * Num < (1u << (31 - CST_DIGITS)), "scaled signal overflows s32fp");
+      return Value(data) * (Num << CST_DIGITS) / Den + FP_FROMINT(Offset);
+   }
+
+   /** Scaled physical value as float */
+   static inline float Phys(const uint32_t data[2])
+   {
+      return Value(data) * ((float)Num / Den) + Offset;
+   }
+
+private:
+   /* Intel: LSB at Start. Shift counts are masked so the branches that are
+    * discarded at compile time never contain an out of range shift. */
+   static inline uint32_t IntelRaw(const uint32_t data[2])
+   {
+      return Start >= 32 ? (data[1] >> (Start & 31)) & Mask
+           : Start + Len <= 32 ? (data[0] >> Start) & Mask
+           : ((data[0] >> (Start & 31)) | (data[1] << ((32 - Start) & 31))) & Mask;
+   }
+
+   /* Motorola: Start is the MSB in the DBC sawtooth numbering. With the payload
+    * byte swapped into one big endian 64 bit word the signal is contiguous again. */
+   static const uint8_t BeLsb = (7 - Start / 8) * 8 + Start % 8 - (Len - 1);
+
+   static inline uint32_t MotorolaRaw(const uint32_t data[2])
+   {
+      return BeLsb >= 32 ? (__builtin_bswap32(data[0]) >> (BeLsb & 31)) & Mask
+           : BeLsb + Len <= 32 ? (__builtin_bswap32(data[1]) >> BeLsb) & Mask
+           : ((__builtin_bswap32(data[1]) >> (BeLsb & 31)) | (__builtin_bswap32(data[0]) << ((32 - BeLsb) & 31))) & Mask;
+   }
+};
+
+#endif // PCSSIGNAL_H_INCLUDED
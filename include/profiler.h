@@ -0,0 +1,83 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H_INCLUDED
+#define PROFILER_H_INCLUDED
+
+#include <stdint.h>
+#include <libopencm3/cm3/dwt.h>
+#include "txsched.h"
+
+#define PROFILER_PROBES \
+   PROBE(ms10)   PROBE(ms100)  PROBE(txslot) PROBE(canrx) \
+   PROBE(rx204)  PROBE(rx2B4)  PROBE(rx264)  PROBE(rx2A4) PROBE(rx2C4) \
+   PROBE(rx3A4)  PROBE(rx424)  PROBE(rx504)  PROBE(rx76C) PROBE(rx109)
+
+/* Execution time of the tasks, the CAN RX callback, the RX handlers and the TX builders
+ * in CPU cycles, taken from the DWT cycle counter.
+ *
+ *    uint32_t start = Profiler::Start();
+ *    ...
+ *    Profiler::Stop(Profiler::PRB_ms10, start);
+ *
+ * Every probe records count, min, max and the sum for the mean. Probes given a period
+ * with SetPeriod() also record the worst deviation of the interval between two starts
+ * from that period, and count a deadline miss whenever a run takes longer than the
+ * period. TX builders use probe PRB_TX0 + their TxScheduler table index.
+ *
+ * Everything profiled runs on the scheduler/CAN interrupt level, so probes never
+ * preempt each other. Nested probes include the time of the inner ones. */
+class Profiler
+{
+public:
+#define PROBE(name) PRB_##name,
+   enum Probe { PROFILER_PROBES PRB_TX0, PRB_LAST = PRB_TX0 + TxScheduler::MAX_SLOTS };
+#undef PROBE
+
+   enum { CYCLES_PER_US = 72 };
+   enum Stat { STAT_COUNT, STAT_MIN, STAT_MEAN, STAT_MAX, STAT_JITTER, STAT_MISSES, STAT_LAST };
+
+   /** Starts the cycle counter, call before the scheduler */
+   static void Init();
+   static void SetPeriod(int probe, uint32_t us);
+   static uint32_t Start() { return DWT_CYCCNT; }
+   static void Stop(int probe, uint32_t start);
+   /** Value of a statistic in cycles, 0 if the probe never ran */
+   static uint32_t Get(int probe, Stat stat);
+   /** Name of the fixed probes, 0 for TX builders */
+   static const char* GetName(int probe);
+   static void Reset();
+
+private:
+   struct Counters
+   {
+      uint32_t count;
+      uint32_t min;
+      uint32_t max;
+      uint64_t sum;
+      uint32_t period;      // cycles, 0 = not periodic
+      uint32_t lastStart;   // 0 = no reference
+      uint32_t maxJitter;
+      uint32_t misses;
+   };
+
+   static Counters probes[PRB_LAST];
+};
+
+#endif // PROFILER_H_INCLUDED
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SDOBULK_H_INCLUDED
+#define SDOBULK_H_INCLUDED
+
+#include <stdint.h>
+
+/* Bulk read of the display values in a single SDO upload, instead of one expedited
+ * request per value.
+ *
+ * Reading INDEX_VALUES sub SUB_ALL returns every display value, sub SUB_RANGE those whose
+ * ID lies in the range last written to INDEX_RANGE (first ID | last ID << 16, inclusive).
+ * Sub SUB_CHANGED returns the parameters and values changed after the sequence number
+ * last written to INDEX_SINCE (see ChangeLog), preceded by a record with ID 0 holding
+ * the sequence number to ask with next time. Reading INDEX_SINCE gives the current one.
+ *
+ * The data is a packed array of RECORD_SIZE byte records in parameter list order:
+ * uint16_t ID and int32_t raw fixed point value (value / 32), little endian. The values
+ * are copied when the transfer starts, so one upload is one consistent snapshot.
+ *
+ * Block upload and segmented upload are served. CanSdo only hands expedited requests to
+ * the application, so HandleRx() runs in CanCallback before CanSdo sees the frame and
+ * claims the initiate requests for INDEX_VALUES plus, while a transfer is open, the
+ * follow up requests of that protocol. Run() answers from the main loop. Block segments
+ * only go out while at least two TX mailboxes are free, so a bulk read delays the
+ * periodic frames by one frame at most. A transfer the client abandons is dropped after
+ * TIMEOUT_MS. */
+class SdoBulk
+{
+public:
+   enum { INDEX_VALUES = 0x4120, INDEX_RANGE = 0x4121, INDEX_SINCE = 0x4122 };
+   enum { SUB_ALL = 0, SUB_RANGE = 1, SUB_CHANGED = 2 };
+   enum { RECORD_SIZE = 6, TIMEOUT_MS = 1000 };
+
+   /** CAN RX interrupt, returns true if the frame belongs to a bulk transfer */
+   static bool HandleRx(const uint32_t data[2]);
+   /** Main loop, returns true while a request was served or segments are waiting */
+   static bool Run();
+   static void SetRange(uint32_t r) { range = r; }
+   static uint32_t GetRange() { return range; }
+   static void SetSince(uint32_t s) { since = s; }
+
+private:
+   enum State { IDLE, SEGMENTED, BLOCK_START, BLOCK_SEND, BLOCK_ACK, BLOCK_END };
+
+   static void Process(const uint32_t req[2]);
+   static bool Snapshot(uint8_t subIndex);
+   static void SendSegments();
+   static void Reply(uint8_t cmd, uint32_t data);
+   static void Abort(uint32_t code);
+
+   static volatile uint8_t state;
+   static volatile bool requestPending;
+   static uint32_t request[2];
+   static uint32_t lastRequest;   // ms
+   static uint32_t range;
+   static uint32_t since;
+   static uint8_t subIndex;
+   static uint16_t size;          // bytes in the snapshot
+   static uint16_t offset;        // bytes confirmed by the client
+   static uint8_t toggle;         // segmented
+   static uint8_t blockSize;      // block, segments per block
+   static uint8_t seqno;          // block, last segment sent in this block
+   static uint16_t crc;
+};
+
+#endif // SDOBULK_H_INCLUDED
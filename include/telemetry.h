@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRY_H_INCLUDED
+#define TELEMETRY_H_INCLUDED
+
+#include <stdint.h>
+#include "params.h"
+
+/* Binary telemetry of a selectable set of values on the telemetry USART, sent by DMA.
+ *
+ * Every frame is
+ *
+ *    0xA5 0x5A type seq len_lo len_hi time[4] payload[len] pad crc[4]
+ *
+ * all little endian, padded with zeros so the CRC starts on a word boundary. The CRC is
+ * the STM32 hardware CRC-32 (poly 0x04C11DB7, init 0xFFFFFFFF, no reflection) over all
+ * preceding words of the frame, read as little endian words. time is Timebase::Millis()
+ * of the sample.
+ *
+ *    FRM_NAMES  CST_DIGITS, count, then the value names separated by ','
+ *    FRM_KEY    count, then count raw s32fp values as int32
+ *    FRM_DELTA  count, then the difference of each value to the previous frame as
+ *               zigzag encoded varint (7 bits per byte, LSB first, bit 7 = more)
+ *
+ * Every KEYFRAME_INTERVAL-th frame and the first one after a change of the value set is a
+ * FRM_NAMES frame directly followed by a FRM_KEY frame, so a decoder can start anywhere.
+ *
+ * Sample() runs in task context and only copies the values. Send() runs from the main loop,
+ * encodes the frame and starts the DMA, it never waits: a sample that finds the previous one
+ * unsent or the DMA still busy is dropped and counted. Deltas always refer to the last frame
+ * sent, so a dropped sample only leaves a gap in time, while a gap in seq means frames were
+ * lost on the line. The hardware CRC unit is only used from the main loop, like the parameter
+ * save does. */
+class Telemetry
+{
+public:
+   enum { MAX_VALUES = 32, KEYFRAME_INTERVAL = 100 };
+   enum FrameType { FRM_KEY = 0, FRM_DELTA = 1, FRM_NAMES = 2 };
+
+   /** Selects the default value set */
+   static void Init();
+   static void Clear();
+   static bool Add(Param::PARAM_NUM value);
+   static int GetCount() { return count; }
+   static Param::PARAM_NUM GetValue(int i) { return values[i]; }
+   /** Task context, copies the selected values */
+   static void Sample(uint32_t time);
+   /** Main loop, encodes and transmits the last sample */
+   static void Send();
+   static uint32_t GetDrops() { return drops; }
+
+private:
+   static uint8_t* BeginFrame(uint8_t* p, FrameType type, uint32_t time);
+   static uint8_t* EndFrame(uint8_t* frame, uint8_t* end);
+
+   static Param::PARAM_NUM values[MAX_VALUES];
+   static int count;
+   static s32fp sample[MAX_VALUES];
+   static uint32_t sampleTime;
+   static volatile bool sampleFull;
+   static s32fp reference[MAX_VALUES];   // values of the last frame sent
+   static bool keyNeeded;
+   static uint8_t seq;
+   static uint8_t sinceKey;
+   static uint32_t drops;
+};
+
+#endif // TELEMETRY_H_INCLUDED
@@ -0,0 +1,40 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMEBASE_H_INCLUDED
+#define TIMEBASE_H_INCLUDED
+
+#include <stdint.h>
+
+/* Free running millisecond clock driven by the SysTick interrupt (see systick_setup()).
+ * The RTC only resolves whole seconds, this is used wherever events need ordering
+ * or latencies need measuring. Wraps after ~49 days, compare with unsigned differences. */
+class Timebase
+{
+public:
+   static void Tick() { ms = ms + 1; }
+   static uint32_t Millis() { return ms; }
+   /** Millis() refined with the SysTick down counter. Wraps after ~71 minutes */
+   static uint32_t Micros();
+
+private:
+   static volatile uint32_t ms;
+};
+
+#endif // TIMEBASE_H_INCLUDED
@@ -0,0 +1,92 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TXSCHED_H_INCLUDED
+#define TXSCHED_H_INCLUDED
+
+#include <stdint.h>
+#include "PCSCan.h"
+
+struct TxSlot
+{
+   enum { ID_CANLOGID = 0x8000 };                // id flag, the frame goes out on canlogid + the rest of id
+
+   uint16_t id;                                  // for statistics only, see GetId()
+   uint16_t period;                              // ms, multiple of TxScheduler::SLOT_MS
+   bool (*build)(const ControlInputs& in);       // builds and sends the frame, false if it sent none
+   bool pcsFrame;                                // only sent while CAN_Enable is set
+   uint8_t onChange;                             // InputChange bits that send the frame right away
+};
+
+/* Table-driven TX scheduler on a SLOT_MS grid. Init() gives every message a phase offset
+ * within its period so that the slots of the 100ms hyperperiod carry as few frames as
+ * possible, instead of all 10/50/100ms frames going out on the same tick. Run() is called
+ * from a scheduler task every SLOT_MS and sends whatever is due in the current slot.
+ *
+ * A message whose onChange inputs changed since the last slot is sent once more in the
+ * current slot instead of waiting for its period, but never sooner than minGapMs after its
+ * previous frame. When its periodic frame is due within minGapMs the event waits for that
+ * one instead. The event frame is extra, the message keeps the phase Init() gave it, and
+ * IsEventSend() tells its build function which kind of frame it is building.
+ *
+ * For every message the worst deviation of the actual send interval from its period is
+ * recorded, as is the worst number of frames pending in the mailboxes and the Stm32Can
+ * software queue right after a slot was sent. Both only count the calls in which the
+ * build function did send a frame, jitter only between frames of consecutive periods.
+ *
+ * The logger slots decimate to their own interval or are switched off, so Init() gives
+ * them the least loaded phase but does not count them in the load of the others. */
+class TxScheduler
+{
+public:
+   enum { SLOT_MS = 2, HYPERPERIOD_MS = 100, MAX_SLOTS = 24 };
+
+   static void Init(const TxSlot* table, int count);
+   static void Run(bool canEnable, uint16_t minGapMs);
+   static int GetCount() { return count; }
+   static const TxSlot& GetSlot(int i) { return table[i]; }
+   /** CAN ID of a message as it currently goes out */
+   static uint16_t GetId(int i);
+   static uint8_t GetPhase(int i) { return phase[i] * SLOT_MS; }
+   static uint32_t GetMaxJitter(int i) { return maxJitter[i]; }
+   static uint8_t GetQueueHighWater() { return queueHighWater; }
+   static uint32_t GetEventSends() { return eventSends; }
+   /** True while the build function of an event frame runs */
+   static bool IsEventSend() { return eventSend; }
+   static void ResetStatistics();
+   /** Empty hardware TX mailboxes, for senders that must not crowd out the slots */
+   static int FreeMailboxes();
+
+private:
+   static const TxSlot* table;
+   static int count;
+   static uint16_t slot;
+   static uint8_t phase[MAX_SLOTS];        // in slots
+   static uint32_t lastSent[MAX_SLOTS];    // us, 0 = no reference
+   static uint32_t lastDue[MAX_SLOTS];     // us, last periodic frame, 0 = no reference
+   static uint32_t maxJitter[MAX_SLOTS];   // us
+   static uint8_t queueHighWater;
+   static uint32_t eventPending;           // bit per message
+   static uint32_t eventSends;
+   static bool eventSend;
+   static ControlInputs lastInputs;
+   static bool haveInputs;
+};
+
+#endif // TXSCHED_H_INCLUDED
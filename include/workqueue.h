@@ -0,0 +1,54 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKQUEUE_H_INCLUDED
+#define WORKQUEUE_H_INCLUDED
+
+#include <stdint.h>
+
+typedef void (*WorkFunction)(void);
+
+/* Deferred work for the main loop. The jobs are a fixed table, the index of a job is its
+ * priority: Run() always picks the lowest pending index next, so a job posted while a
+ * lower priority one runs goes ahead of the rest.
+ *
+ * A job is either pending or not, posting it again before it ran does not queue a second
+ * run but counts an overrun. Jobs that must not lose ticks have to work out themselves
+ * how much time passed since they last ran.
+ *
+ * Post() may be called from interrupts, Run() only from the main loop. */
+class WorkQueue
+{
+public:
+   enum { MAX_JOBS = 32 };
+
+   static void Init(const WorkFunction* jobs, int count);
+   static void Post(int job);
+   /** Returns true if any job ran */
+   static bool Run();
+   static uint32_t GetOverruns() { return overruns; }
+
+private:
+   static const WorkFunction* jobs;
+   static int count;
+   static uint32_t pending;   // bit per job
+   static uint32_t overruns;
+};
+
+#endif // WORKQUEUE_H_INCLUDED
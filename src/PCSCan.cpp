@@ -20,6 +20,11 @@
 
 
 #include "PCSCan.h"
+#include "pcssignal.h"
+#include "pcsshadow.h"
+#include "pcsalerts.h"
+#include "journal.h"
+#include "busstats.h"
 
 // PCS Control Flags
 bool mux3b2 = true;              // Multiplexer flag for message 3B2
@@ -31,40 +36,30 @@ bool GotDCI = false;             // DCI received flag
 
 // Power and Current Settings
 uint16_t PCS_Power_Req = 0;      // PCS power request
-uint16_t DCDCSpnt = 0;           // DCDC setpoint
-uint16_t DCDCAmps = 0;           // DCDC current in amps
-uint16_t ACLim = 0;              // AC current limit
-float ACPwr = 0;                 // AC power
-float ChgPavail = 0;             // Available charging power
-float DCDCPwr = 0;               // DCDC power
+s32fp DCDCAmps = 0;              // DCDC current in amps
+s32fp ACLim = 0;                 // AC current limit
+s32fp ACPwr = 0;                 // AC power
+s32fp ChgPavail = 0;             // Available charging power
+s32fp DCDCPwr = 0;               // DCDC power
 
 // Voltage and Current Measurements
-uint16_t ACVolts = 0;            // AC voltage
-uint16_t ACAmps = 0;             // AC current
+s32fp ACVolts = 0;               // AC voltage
+s32fp ACAmps = 0;                // AC current
 uint16_t HVVolts = 0;          // High voltage
-float LVVolts = 0;               // Low voltage
-float IOut_PhA = 0;              // Output current Phase A
-float IOut_PhB = 0;              // Output current Phase B
-float IOut_PhC = 0;              // Output current Phase C
-float IOut_Total = 0;            // Total output current
-uint8_t ACILim = 0;              // AC current limit (8-bit)
-float ChgPhAKWh = 0;             // Lifetime AC input energy Phase A
-float ChgPhBKWh = 0;             // Lifetime AC input energy Phase B
-float ChgPhCKWh = 0;             // Lifetime AC input energy Phase C
-float DcdcOutKWh = 0;            // Lifetime DCDC 12V-support output energy, cached for the battery estimate below
+s32fp LVVolts = 0;               // Low voltage
+s32fp IOut_PhA = 0;              // Output current Phase A
+s32fp IOut_PhB = 0;              // Output current Phase B
+s32fp IOut_PhC = 0;              // Output current Phase C
+s32fp IOut_Total = 0;            // Total output current
+s32fp ChgPhAKWh = 0;             // Lifetime AC input energy Phase A
+s32fp ChgPhBKWh = 0;             // Lifetime AC input energy Phase B
+s32fp ChgPhCKWh = 0;             // Lifetime AC input energy Phase C
+s32fp DcdcOutKWh = 0;            // Lifetime DCDC 12V-support output energy, cached for the battery estimate below
 
 // used to estimate lifetime energy into battery
-// verified against logs to be ~95%
-const float CHG_EFFICIENCY_EST = 0.95f; 
-
-// Temperature Measurements
-int16_t TempLocal = 0;           // Local temperature
-uint16_t AmbTemp = 0;            // Ambient temperature
-uint16_t ATemp = 0;              // Temperature phase A
-uint16_t BTemp = 0;              // Temperature phase B
-uint16_t CTemp = 0;              // Temperature phase C
-uint16_t DCDCTemp = 0;           // DCDC temperature
-uint16_t DCDCBTemp = 0;          // DCDC B temperature
+// verified against logs to be ~95%, kept as a ratio so the estimate stays in integer math
+#define CHG_EFFICIENCY_NUM 19
+#define CHG_EFFICIENCY_DEN 20
 
 // PCS Status and Counters
 uint8_t PCSGrid = 0;             // PCS grid status
@@ -84,147 +79,173 @@ uint8_t PCS_AlertCnt = 0;
 uint16_t AlertCANId = 0;
 uint8_t AlertRxError = 0;
 static uint8_t pcs_alert_matrix[10] __attribute__((unused)) = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}; // legacy 0x424 log buffer
-static uint8_t pcs_alert_active[121] = {0}; // live active flags from 0x3A4 matrix, indexed by alert ID (1..102)
 
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////PCS CAN Signals To Receive (start bit, length, byte order, signed, scale num/den, offset)
+///////////////////////////////////////////////////////////////////////////
+
+// 0x204 PCS charge status
+typedef CanSignal<0,  4>                                  PCS_chgMainState;     // 0=init .. 9=clear faults
+typedef CanSignal<6,  2>                                  PCS_gridConfig;       // 0=none, 1=1P, 2=3P, 3=3P delta
+typedef CanSignal<24, 8,  SIG_INTEL, false, 1, 10>        PCS_chgPwrAvailable;  // kW
+typedef CanSignal<59, 2>                                  PCS_hwVariantType;    // 0=48A 1P, 1=32A 1P, 2=3P
+
+// 0x2B4 PCS DC-DC status
+typedef CanSignal<0,  10, SIG_INTEL, false, 5, 128>       PCS_dcdcLvBusVolt;       // V, scale 0.0390625
+typedef CanSignal<24, 12, SIG_INTEL, false, 1, 10>        PCS_dcdcLvOutputCurrent; // A
+
+// 0x264 PCS charge line status
+typedef CanSignal<0,  14, SIG_INTEL, false, 33, 1000>     PCS_chgLineVoltage;      // V
+typedef CanSignal<14, 9,  SIG_INTEL, false, 1, 10>        PCS_chgLineCurrent;      // A
+typedef CanSignal<24, 8,  SIG_INTEL, false, 1, 10>        PCS_chgLinePower;        // kW
+typedef CanSignal<32, 10, SIG_INTEL, false, 1, 10>        PCS_chgLineCurrentLimit; // A
+
+// 0x2A4 PCS temperatures, all 11 bit signed x0.1 +40 except the DC-DC B sensor
+typedef CanSignal<0,  11, SIG_INTEL, true,  1, 10, 40>    PCS_chgPhATemp;
+typedef CanSignal<11, 11, SIG_INTEL, true,  1, 10, 40>    PCS_chgPhBTemp;
+typedef CanSignal<22, 11, SIG_INTEL, true,  1, 10, 40>    PCS_chgPhCTemp;
+typedef CanSignal<33, 11, SIG_INTEL, true,  1, 10, 40>    PCS_dcdcTemp;
+typedef CanSignal<44, 11, SIG_INTEL, true,  1, 10, 40>    PCS_ambientTemp;
+typedef CanSignal<55, 9,  SIG_INTEL, false, 150, 511>     PCS_dcdcBTemp;           // scale 0.293542
+
+// 0x2C4 PCS logging, multiplexed by byte 0 (mux id in the low 5 bits)
+typedef CanSignal<0,  8>                                  PCS_logMessageSelect;
+typedef CanSignal<0,  5>                                  PCS_logMux;
+typedef CanSignal<16, 12, SIG_INTEL, false, 75, 512>      PCS_dcdcHvBusVolt;       // mux 6, V, scale 0.146484
+typedef CanSignal<51, 12, SIG_INTEL, false, 75, 512>      PCS_chgHvBusVolt;        // mux 4, backup source
+typedef CanSignal<32, 8,  SIG_INTEL, false, 1, 10>        PCS_chgPhOutputCurrent;  // mux 0..2, A
+typedef CanSignal<31, 24, SIG_INTEL, false, 1, 100>       PCS_chgPhLifetimeKWh;    // mux 0x0A..0x0C
+typedef CanSignal<8,  24, SIG_INTEL, false, 1, 100>       PCS_dcdcLifetimeKWh;     // mux 0x16
+
+// 0x3A4 PCS alert matrix
+typedef CanSignal<0,  4>                                  PCS_matrixIndex;
+
+// 0x424 PCS alert log
+typedef CanSignal<0,  8>                                  PCS_alertId;
+typedef CanSignal<16, 3>                                  PCS_alertRxError;
+typedef CanSignal<24, 16>                                 PCS_alertCanId;
+
+// 0x504 PCS boot id
+typedef CanSignal<56, 8>                                  PCS_bootId;
+
+// 0x76C PCS debug output, multiplexed by byte 0
+typedef CanSignal<0,  8>                                  PCS_dbgMux;
+typedef CanSignal<8,  10, SIG_INTEL, false, 1, 400>       PCS_dbgChgPhOutputCurrent; // mux 0x0C/0x16/0x20, A
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////PCS CAN Messages To Receive
 ///////////////////////////////////////////////////////////////////////////
 
 void PCSCan::handle204(uint32_t data[2]) // PCS Chg status. Power,Amps,PCS config,grid stat
 {
-   uint8_t *bytes = (uint8_t *)data; // byte 0 bits 4,5 = Chg state. 0=standby, 1=blocked, 2=enabled,3=faulted.
-                                     // byte 0 bits 6,7 = grid config. 0=none, 1=single phase, 2=three phase, 3=three phase delta
-
-   PCS_HW = (bytes[7] >> 3) & 0x03; // byte 7 bits 3,4 = HW type. 0=48A single phase , 1=32A single phase, 2=Three phase.
-   Param::SetInt(Param::PCS_Type, PCS_HW);
+   PCS_HW = PCS_hwVariantType::Raw(data);
+   PcsShadow::SetInt(PcsShadow::PCS_Type, PCS_HW);
    if (PCS_HW == 0)
-      Param::SetInt(Param::hwaclim, 48);
+      PcsShadow::SetInt(PcsShadow::hwaclim, 48);
    if (PCS_HW == 1)
-      Param::SetInt(Param::hwaclim, 32);
+      PcsShadow::SetInt(PcsShadow::hwaclim, 32);
    if (PCS_HW == 2)
-      Param::SetInt(Param::hwaclim, 16);
+      PcsShadow::SetInt(PcsShadow::hwaclim, 16);
 
-   PCS_CHG_STAT = (bytes[0]) & 0x0f; // byte 0 bits 0-3 = charger main state. 0=init, 1=idle, 2=startup, 3=wait for line voltage
-                                     // 4=qualify line config, 5=enable, 7=shutdown, 8=faulted, 9=clear faults
-   Param::SetInt(Param::CHG_STAT, PCS_CHG_STAT);
+   uint8_t chgStat = PCS_chgMainState::Raw(data);
+   if (chgStat != PCS_CHG_STAT) Journal::Log(Journal::REC_CHG_STAT, chgStat);
+   PCS_CHG_STAT = chgStat;
+   PcsShadow::SetInt(PcsShadow::CHG_STAT, PCS_CHG_STAT);
 
-   ChgPavail = bytes[3] * 0.1f; // byte 2 = available charger power x 0.1 in kw.
-   Param::SetFloat(Param::CHGPAvail, ChgPavail);
+   ChgPavail = PCS_chgPwrAvailable::Fixed(data);
+   PcsShadow::Set(PcsShadow::CHGPAvail, ChgPavail);
 
-   PCSGrid = (bytes[0] >> 6) & 0x3; // byte 0 bits 6,7 = grid config. 0=none, 1=single phase, 2=three phase, 3=three phase delta
-   Param::SetInt(Param::GridCFG, PCSGrid);
+   PCSGrid = PCS_gridConfig::Raw(data);
+   PcsShadow::SetInt(PcsShadow::GridCFG, PCSGrid);
 }
 
 void PCSCan::handle2B4(uint32_t data[2]) // DCDC Info
 {
-   uint8_t *bytes = (uint8_t *)data;
+   LVVolts = PCS_dcdcLvBusVolt::Fixed(data);
+   PcsShadow::Set(PcsShadow::ulv, LVVolts);
 
-   // PCS_dcdcLvBusVolt: starts at bit 0, length 10 bits, scale 0.0390625
-   LVVolts = ((bytes[0] | ((bytes[1] & 0x03) << 8)) * 0.0390625);
-   Param::SetFloat(Param::ulv, LVVolts);
+   DCDCAmps = PCS_dcdcLvOutputCurrent::Fixed(data);
+   PcsShadow::Set(PcsShadow::idcdc, DCDCAmps);
 
-   // PCS_dcdcLvOutputCurrent: starts at bit 24, length 12 bits, scale 0.1
-   DCDCAmps = (((bytes[3] | ((bytes[4] & 0x0F) << 8)) & 0xFFF) * 0.1);
-   Param::SetFloat(Param::idcdc, DCDCAmps);
-   
-   DCDCPwr = DCDCAmps * LVVolts;
-   Param::SetFloat(Param::powerdcdc, DCDCPwr);
+   DCDCPwr = FP_MUL(DCDCAmps, LVVolts);
+   PcsShadow::Set(PcsShadow::powerdcdc, DCDCPwr);
 }
 
 void PCSCan::handle264(uint32_t data[2]) // PCS Chg Line Status
 {
-   uint8_t *bytes = (uint8_t *)data; //
-
-   ACLim = (((bytes[5] << 8 | bytes[4]) & 0x3ff) * 0.1);
-   ACPwr = ((bytes[3]) * .1f);
-   ACVolts = (((bytes[1] << 8 | bytes[0]) & 0x3FFF) * 0.033);
-   ACAmps = (((bytes[2] << 9 | bytes[1]) >> 7) * 0.1);
-
-   Param::SetFloat(Param::powerac, ACPwr);
-   Param::SetFloat(Param::uac, ACVolts);
-   Param::SetFloat(Param::iac, ACAmps);
-   Param::SetFloat(Param::ChgACLim, ACLim);
+   ACLim = PCS_chgLineCurrentLimit::Fixed(data);
+   ACPwr = PCS_chgLinePower::Fixed(data);
+   ACVolts = PCS_chgLineVoltage::Fixed(data);
+   ACAmps = PCS_chgLineCurrent::Fixed(data);
+
+   PcsShadow::Set(PcsShadow::powerac, ACPwr);
+   PcsShadow::Set(PcsShadow::uac, ACVolts);
+   PcsShadow::Set(PcsShadow::iac, ACAmps);
+   PcsShadow::Set(PcsShadow::ChgACLim, ACLim);
 }
 
 void PCSCan::handle2A4(uint32_t data[2]) // PCS Temps
 {
-   uint8_t *bytes = (uint8_t *)data;
-   // PCS_ambientTemp bits 44 to 54 x 0.1
-   // PCS_chgPhATemp bits 0-10 x0.1
-   // PCS_chgPhbTemp bits 11-21 x0.1
-   // PCS_chgPhcTemp bits 22-32 x0.1
-   // DCDC Temp bits 33-43 x0.1
-
-   ATemp = ((bytes[1] << 8 | bytes[0]));
-   BTemp = ((bytes[2] << 8 | bytes[1]) >> 3);
-   CTemp = ((bytes[4] << 15 | bytes[3] << 7 | bytes[2] >> 1) >> 5);
-   DCDCTemp = ((bytes[5] << 8 | bytes[4]) >> 1);
-   DCDCBTemp = (((bytes[7] << 8 | bytes[6]) >> 7) & 0x1FF) * 0.293542;
-   AmbTemp = ((bytes[6] << 8 | bytes[5]) >> 4);
-   Param::SetFloat(Param::ChgATemp, ProcessTemps(ATemp));
-   Param::SetFloat(Param::ChgBTemp, ProcessTemps(BTemp));
-   Param::SetFloat(Param::ChgCTemp, ProcessTemps(CTemp));
-   Param::SetFloat(Param::DCDCTemp, ProcessTemps(DCDCTemp));
-   Param::SetFloat(Param::DCDCBTemp, DCDCBTemp);
-   Param::SetFloat(Param::PCSAmbTemp, ProcessTemps(AmbTemp));
+   PcsShadow::Set(PcsShadow::ChgATemp, PCS_chgPhATemp::Fixed(data));
+   PcsShadow::Set(PcsShadow::ChgBTemp, PCS_chgPhBTemp::Fixed(data));
+   PcsShadow::Set(PcsShadow::ChgCTemp, PCS_chgPhCTemp::Fixed(data));
+   PcsShadow::Set(PcsShadow::DCDCTemp, PCS_dcdcTemp::Fixed(data));
+   PcsShadow::Set(PcsShadow::DCDCBTemp, PCS_dcdcBTemp::Fixed(data));
+   PcsShadow::Set(PcsShadow::PCSAmbTemp, PCS_ambientTemp::Fixed(data));
 }
 
 void PCSCan::handle2C4(uint32_t data[2]) // PCS Logging
 {
-   uint8_t *bytes = (uint8_t *)data;
-   mux2C4 = (bytes[0]);
-   if ((mux2C4 == 0xE6) || (mux2C4 == 0xC6)) // if in mux 6 grab the info...
+   uint8_t select = PCS_logMessageSelect::Raw(data);
+   if ((select == 0xE6) || (select == 0xC6)) // if in mux 6 grab the info...
    {
-      HVVolts = (((bytes[3] << 8 | bytes[2]) & 0xFFF) * 0.146484);  // measured hv voltage. 12 bit unsigned int in bits 16-27. scale 0.146484.
-      //LVVolts = ((((bytes[1] << 9 | bytes[0]) >> 6)) * 0.0390625f); // measured lv voltage. 10 bit unsigned int in bits 5-14. scale 0.0390626.
+      HVVolts = FP_TOINT(PCS_dcdcHvBusVolt::Fixed(data));
       Backup2c4 = false;
    }
-   else if ((mux2C4 == 0x04) && (Backup2c4)) // if we dont get HV volts then switch to backup.
+   else if ((select == 0x04) && (Backup2c4)) // if we dont get HV volts then switch to backup.
    {
-      HVVolts = ((((bytes[7] << 8 | bytes[6]) >> 3) & 0xFFF) * 0.146484); // measured hv voltage. 12 bit unsigned int in bits 51-62. scale 0.146484.
-      //LVVolts = Param::GetFloat(Param::uaux);                             // In new firmware DCDC LV is not in 0x2C4.
+      HVVolts = FP_TOINT(PCS_chgHvBusVolt::Fixed(data));
    }
-   Param::SetFloat(Param::udc, HVVolts);
-   //Param::SetFloat(Param::ulv, LVVolts);
+   PcsShadow::SetInt(PcsShadow::udc, HVVolts);
 
-   mux2C4 = (bytes[0] & 0x1F);
+   mux2C4 = PCS_logMux::Raw(data);
    if (mux2C4 == 0x00) // Calculate total DC output current from all 3 charger modules.
    {
-      IOut_PhA = ((bytes[4])) * 0.1f;
+      IOut_PhA = PCS_chgPhOutputCurrent::Fixed(data);
       GotDCI = true;
    }
    else if (mux2C4 == 0x01)
    {
-      IOut_PhB = ((bytes[4])) * 0.1f;
+      IOut_PhB = PCS_chgPhOutputCurrent::Fixed(data);
       GotDCI = true;
    }
    else if (mux2C4 == 0x02)
    {
-      IOut_PhC = ((bytes[4])) * 0.1f;
+      IOut_PhC = PCS_chgPhOutputCurrent::Fixed(data);
       GotDCI = true;
    }
 
    IOut_Total = IOut_PhA + IOut_PhB + IOut_PhC;
-   Param::SetFloat(Param::idc, IOut_Total);
+   PcsShadow::Set(PcsShadow::idc, IOut_Total);
 
-   if (mux2C4 == 0x0A) // Lifetime charge energy Phase A. 24 bit unsigned int in bits 31-54. scale 0.01.
+   if (mux2C4 == 0x0A) // Lifetime charge energy Phase A.
    {
-      ChgPhAKWh = ((bytes[3] >> 7) | (bytes[4] << 1) | (bytes[5] << 9) | ((bytes[6] & 0x7F) << 17)) * 0.01f;
+      ChgPhAKWh = PCS_chgPhLifetimeKWh::Fixed(data);
    }
    else if (mux2C4 == 0x0B) // Lifetime charge energy Phase B.
    {
-      ChgPhBKWh = ((bytes[3] >> 7) | (bytes[4] << 1) | (bytes[5] << 9) | ((bytes[6] & 0x7F) << 17)) * 0.01f;
+      ChgPhBKWh = PCS_chgPhLifetimeKWh::Fixed(data);
    }
    else if (mux2C4 == 0x0C) // Lifetime charge energy Phase C.
    {
-      ChgPhCKWh = ((bytes[3] >> 7) | (bytes[4] << 1) | (bytes[5] << 9) | ((bytes[6] & 0x7F) << 17)) * 0.01f;
-      Param::SetFloat(Param::PCSAcKWh, ChgPhAKWh + ChgPhBKWh + ChgPhCKWh);
+      ChgPhCKWh = PCS_chgPhLifetimeKWh::Fixed(data);
+      PcsShadow::Set(PcsShadow::PCSAcKWh, ChgPhAKWh + ChgPhBKWh + ChgPhCKWh);
    }
-   else if (mux2C4 == 0x16) // Lifetime DCDC 12V-support energy. 24 bit unsigned int in bits 8-31. scale 0.01.
+   else if (mux2C4 == 0x16) // Lifetime DCDC 12V-support energy.
    {
-      DcdcOutKWh = (bytes[1] | (bytes[2] << 8) | (bytes[3] << 16)) * 0.01f;
-      Param::SetFloat(Param::PCSDcdcKWh, DcdcOutKWh);
+      DcdcOutKWh = PCS_dcdcLifetimeKWh::Fixed(data);
+      PcsShadow::Set(PcsShadow::PCSDcdcKWh, DcdcOutKWh);
    }
 
    // Rough estimate of energy delivered to the battery: AC input minus the DCDC's
@@ -232,34 +253,24 @@ void PCSCan::handle2C4(uint32_t data[2]) // PCS Logging
    // 0.95 comes from comparing PCS_chgPhX/dcdc lifetime counters against measured
    // BMS pack energy over a real charge session at steady-state power (94.2%) and
    // over the whole session (95.3%) - not a manufacturer figure.
-   float battKWh = (ChgPhAKWh + ChgPhBKWh + ChgPhCKWh - DcdcOutKWh) * CHG_EFFICIENCY_EST;
-   Param::SetFloat(Param::PCSBattKWh, battKWh > 0 ? battKWh : 0);
+   s32fp battKWh = (ChgPhAKWh + ChgPhBKWh + ChgPhCKWh - DcdcOutKWh) * CHG_EFFICIENCY_NUM / CHG_EFFICIENCY_DEN;
+   PcsShadow::Set(PcsShadow::PCSBattKWh, battKWh > 0 ? battKWh : 0);
 }
 
-void PCSCan::handle3A4(uint32_t data[2]) // PCS Alert Matrix (live bitmap of currently-active alerts)
+void PCSCan::handle3A4(uint32_t data[2], uint32_t time) // PCS Alert Matrix (live bitmap of currently-active alerts)
 {
-   // Multiplexed by PCS_matrixIndex (byte 0, low nibble). Each page carries 60 alerts in bits 4..63:
-   // page 0 -> alerts 1..60, page 1 -> alerts 61..120. For page p, bit b -> alertID = p*60 + (b-3).
-   // Writing both 1s and 0s here means each page frame auto-clears alerts that are no longer active.
-   uint8_t *bytes = (uint8_t *)data;
-   uint8_t page = bytes[0] & 0x0F; // PCS_matrixIndex multiplexor
-   PCSAlertPage = page;
-   for (uint8_t bit = 4; bit < 64; bit++)
-   {
-      uint8_t id = page * 60 + (bit - 3); // bit 4 -> first alert of this page
-      if (id > 102)
-         break; // ignore undefined bits beyond the last alert
-      pcs_alert_active[id] = (bytes[bit >> 3] >> (bit & 0x07)) & 0x01;
-   }
+   // Multiplexed by PCS_matrixIndex (byte 0, low nibble). Each page frame carries the full state of
+   // its alerts, so alerts that are no longer active are cleared by the next frame of their page.
+   PCSAlertPage = PCS_matrixIndex::Raw(data);
+   PcsAlerts::UpdatePage(PCSAlertPage, data, time);
 }
 
 void PCSCan::handle424(uint32_t data[2]) // PCS Alert Log
 {
-   uint8_t *bytes = (uint8_t *)data;
-   PCSAlertId = bytes[0];
+   PCSAlertId = PCS_alertId::Raw(data);
 
    // Legacy 0x424 alert-log buffer. Display is now driven by the live 0x3A4 matrix (see handle3A4 /
-   // AlertHandler). Kept commented for reference; do not remove yet.
+   // PcsAlerts). Kept commented for reference; do not remove yet.
    // if (Param::GetBool(Param::AlertLog))
    // {
    //    pcs_alert_matrix[PCS_AlertCnt] = PCSAlertId;
@@ -268,47 +279,52 @@ void PCSCan::handle424(uint32_t data[2]) // PCS Alert Log
    //       PCS_AlertCnt = 0;
    //    Param::SetInt(Param::PCSAlertCnt, PCS_AlertCnt);
    // }
+   // Param::SetInt(Param::PCSAlerts, pcs_alert_matrix[Param::GetInt(Param::Alerts)]);
+   // if (!Param::GetBool(Param::AlertLog))
+   // {
+   //    PCS_AlertCnt = 0;
+   //    Param::SetInt(Param::PCSAlertCnt, PCS_AlertCnt);
+   //    for (int i = 0; i < 10; i++)
+   //       pcs_alert_matrix[i] = 0; // Clear log and counter when PCS alert logging disabled
+   // }
 
    if (PCSAlertId == 0x1E) // 0x1E = Alert30= CAN rationality.
    {
-      AlertCANId = ((bytes[4] << 8 | bytes[3])); // Grab the CAN ID from the alert.
-      AlertRxError = (bytes[2] & 0x07);          // Grab the alert detail
-      ProcessCANRat(AlertCANId, AlertRxError);   // call processing routine.
+      AlertCANId = PCS_alertCanId::Raw(data);    // Grab the CAN ID from the alert.
+      AlertRxError = PCS_alertRxError::Raw(data); // Grab the alert detail
+      ProcessCANRat(AlertCANId, AlertRxError);    // call processing routine.
    }
 }
 
 void PCSCan::handle504(uint32_t data[2]) // PCS Boot ID
 {
-   uint8_t *bytes = (uint8_t *)data;
-   PCSBootId = bytes[7];
-   Param::SetInt(Param::PCSBoot, PCSBootId);
+   PCSBootId = PCS_bootId::Raw(data);
+   PcsShadow::SetInt(PcsShadow::PCSBoot, PCSBootId);
 }
 
 void PCSCan::handle76C(uint32_t data[2]) // PCS Debug output
 {
-   uint8_t *bytes = (uint8_t *)data; // Mux id in byte 0.
-                                     // Mux 0x0C(12) = chg phase A outputs
-                                     // Mux 0x16(22) = chg phase B outputs
-                                     // Mux 0x20(32) = chg phase C outputs
-                                     // IOout=bytes 2,3 14 bit unsigned scale 0.0025
-   mux76C = (bytes[0]);
+   // Mux 0x0C(12) = chg phase A outputs
+   // Mux 0x16(22) = chg phase B outputs
+   // Mux 0x20(32) = chg phase C outputs
+   mux76C = PCS_dbgMux::Raw(data);
    if (!GotDCI)
    {
       if (mux76C == 0x0C) // Calculate total DC output current from all 3 charger modules.
       {
-         IOut_PhA = ((bytes[2] << 8 | bytes[1]) & 0x3ff) * 0.0025f;
+         IOut_PhA = PCS_dbgChgPhOutputCurrent::Fixed(data);
       }
       else if (mux76C == 0x16)
       {
-         IOut_PhB = ((bytes[2] << 8 | bytes[1]) & 0x3ff) * 0.0025f;
+         IOut_PhB = PCS_dbgChgPhOutputCurrent::Fixed(data);
       }
       else if (mux76C == 0x20)
       {
-         IOut_PhC = ((bytes[2] << 8 | bytes[1]) & 0x3ff) * 0.0025f;
+         IOut_PhC = PCS_dbgChgPhOutputCurrent::Fixed(data);
       }
 
       IOut_Total = IOut_PhA + IOut_PhB + IOut_PhC;
-      Param::SetFloat(Param::idc, IOut_Total);
+      PcsShadow::Set(PcsShadow::idc, IOut_Total);
    }
 }
 
@@ -316,66 +332,151 @@ void PCSCan::handle76C(uint32_t data[2]) // PCS Debug output
 ///////PCS CAN Messages to Send
 ///////////////////////////////////////////////////////////////////////////////////////
 
-void PCSCan::Msg13D() // Required by post 2020 firmwares. Mirrors some content in 0x23D.
+// Frames that are constant apart from a few fields are pre-encoded here and live in flash.
+// The builders send them as they are or patch the dynamic fields into a copy of the two payload words.
+struct StaticFrame
+{
+   uint16_t id;
+   uint8_t len;
+   uint8_t chkBase;     // PCS checksum of the template, the dynamic byte 6 bits are added at send time
+   uint32_t data[2];    // byte 0 is the LSB of data[0], as in the RX handlers
+};
+
+static constexpr uint32_t LeWord(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3)
+{
+   return b0 | (b1 << 8) | (b2 << 16) | ((uint32_t)b3 << 24);
+}
+
+// PCS checksum: byte sum of bytes 0..6 plus both bytes of the CAN ID, sent in byte 7
+static constexpr uint8_t PcsChecksum(uint16_t id, uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6)
+{
+   return (b0 + b1 + b2 + b3 + b4 + b5 + b6 + id + (id >> 8)) & 0xFF;
+}
+
+#define STATIC_FRAME(id, len, b0, b1, b2, b3, b4, b5, b6, b7) \
+   { id, len, PcsChecksum(id, b0, b1, b2, b3, b4, b5, b6), { LeWord(b0, b1, b2, b3), LeWord(b4, b5, b6, b7) } }
+
+enum StaticFrameIdx
+{
+   FRM_20A, FRM_212, FRM_232, FRM_25D, FRM_2D1, FRM_321, FRM_333, FRM_3A1,
+   FRM_3B2_CHARGING, FRM_3B2_TERMINATION, FRM_221_MUX1, FRM_221_MUX0, FRM_545_MUX_A, FRM_545_MUX_B,
+   FRM_LAST
+};
+
+// Same order as StaticFrameIdx
+static const StaticFrame staticFrames[] =
+{
+   STATIC_FRAME(0x20A, 6, 0xF6, 0x15, 0x09, 0x82, 0x18, 0x01, 0x00, 0x00), // HVP contactor state
+   STATIC_FRAME(0x212, 8, 0xB9, 0x1C, 0x94, 0xAD, 0xC3, 0x15, 0x06, 0x63), // BMS status
+   STATIC_FRAME(0x232, 8, 0x0A, 0x02, 0xD5, 0x09, 0xCB, 0x04, 0x00, 0x00), // BMS contactor request
+   STATIC_FRAME(0x25D, 8, 0x00, 0x8C, 0x01, 0xB5, 0x4A, 0xC1, 0x0A, 0xE0), // CP status, byte 0 = inlet type
+   STATIC_FRAME(0x2D1, 2, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00), // VCFRONT okToUseHighPower
+   STATIC_FRAME(0x321, 8, 0x2C, 0xB6, 0xA8, 0x7F, 0x02, 0x7F, 0x00, 0x00), // VCFront sensors
+   STATIC_FRAME(0x333, 4, 0x04, 0x30, 0x29, 0x07, 0x00, 0x00, 0x00, 0x00), // UI charge request
+   STATIC_FRAME(0x3A1, 8, 0x09, 0x62, 0x00, 0x99, 0x08, 0x2C, 0x12, 0x5A), // VCFront vehicle status, bytes 2-3 = DC-DC setpoint
+   STATIC_FRAME(0x3B2, 8, 0xE5, 0x0D, 0xEB, 0xFF, 0x0C, 0x66, 0xBB, 0x11), // BMS log2, mux 5 = charging
+   STATIC_FRAME(0x3B2, 8, 0xE3, 0x5D, 0xFB, 0xFF, 0x0C, 0x66, 0xBB, 0x06), // BMS log2, mux 3 = charge termination
+   STATIC_FRAME(0x221, 8, 0x41, 0x01, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00), // VCFRONT_LVPowerState index 1, byte 6 = counter << 5
+   STATIC_FRAME(0x221, 8, 0x40, 0x41, 0x05, 0x15, 0x00, 0x50, 0x11, 0x00), // VCFRONT_LVPowerState index 0, byte 6 |= counter << 5
+   STATIC_FRAME(0x545, 8, 0x14, 0x00, 0x3F, 0x70, 0x9F, 0x01, 0x0A, 0x00), // VCFront, byte 6 |= counter << 4
+   STATIC_FRAME(0x545, 8, 0x03, 0x19, 0x64, 0x32, 0x19, 0x00, 0x00, 0x00), // VCFront, byte 6 = counter << 4
+};
+
+static_assert(sizeof(staticFrames) / sizeof(staticFrames[0]) == FRM_LAST, "staticFrames and StaticFrameIdx out of sync");
+
+// All our frames go through here so the bus accounting sees them
+static void SendFrame(uint32_t id, uint32_t data[2], uint8_t len)
+{
+   BusStats::CountTx(id, len);
+   Stm32Can::GetInterface(0)->Send(id, data, len);
+}
+
+static void SendStatic(const StaticFrame& f)
+{
+   // Stm32Can only reads the payload, the frame stays in flash
+   SendFrame(f.id, const_cast<uint32_t*>(f.data), f.len);
+}
+
+// ORs the counter bits into byte 6 and completes the checksum in byte 7.
+// Counter bits never overlap the template bits of byte 6, so the OR adds to the byte sum.
+static void SendCounted(const StaticFrame& f, uint8_t counterBits)
+{
+   uint8_t checksum = f.chkBase + counterBits;
+   uint32_t data[2] = { f.data[0], f.data[1] | (uint32_t)counterBits << 16 | (uint32_t)checksum << 24 };
+   SendFrame(f.id, data, f.len);
+}
+
+ControlInputs PCSCan::CaptureInputs()
+{
+   ControlInputs in;
+
+   in.opmode = Param::GetInt(Param::opmode);
+   in.activate = Param::GetInt(Param::activate);
+   in.chgStat = Param::GetInt(Param::CHG_STAT);
+   in.chargerEnable = Param::GetInt(Param::chargerEnable) != 0;
+   in.usInlet = Param::GetInt(Param::modelcode) != 0;
+   in.iaclim = Param::GetInt(Param::iaclim);
+   in.pilotLim = in.iaclim * 2;
+   in.pacspnt = Param::GetInt(Param::pacspnt);
+   in.udcspnt = Param::GetInt(Param::udcspnt);
+   in.dcdcSpnt = FP_TOINT(Param::Get(Param::udcdc) * 100);
+   return in;
+}
+
+uint8_t PCSCan::ChangedInputs(const ControlInputs& a, const ControlInputs& b)
+{
+   return (a.activate != b.activate ? IN_ACTIVATE : 0)
+        | (a.chargerEnable != b.chargerEnable ? IN_CHGENABLE : 0)
+        | (a.iaclim != b.iaclim ? IN_CURRENT : 0);
+}
+
+bool PCSCan::Msg13D(const ControlInputs& in) // Required by post 2020 firmwares. Mirrors some content in 0x23D.
 {
-   ACILim = Param::GetInt(Param::iaclim) * 2;
    uint8_t bytes[6];
 
-   bytes[0] = Param::GetInt(Param::chargerEnable) ? 0x05 : 0x0A; // 0x05 if enabled, else 0x0A
-   bytes[1] = ACILim;                                            // charge current limit. gain 0.5. 0x40 = 64 dec =32A. Populate AC lim in here.
+   bytes[0] = in.chargerEnable ? 0x05 : 0x0A; // 0x05 if enabled, else 0x0A
+   bytes[1] = in.pilotLim;                    // charge current limit. gain 0.5. 0x40 = 64 dec =32A. Populate AC lim in here.
    bytes[2] = 0XAA;
    bytes[3] = 0X1A;
    bytes[4] = 0xFF;
    bytes[5] = 0x02;
-   Stm32Can::GetInterface(0)->Send(0x13D, (uint32_t *)bytes, 6);
+   SendFrame(0x13D, (uint32_t *)bytes, 6);
+   return true;
 }
 
-void PCSCan::Msg20A()
+bool PCSCan::Msg20A(const ControlInputs&)
 { // HVP contactor state. Static msg.
-   uint8_t bytes[6];
-   bytes[0] = 0xF6;
-   bytes[1] = 0x15;
-   bytes[2] = 0x09;
-   bytes[3] = 0x82;
-   bytes[4] = 0x18;
-   bytes[5] = 0x01;
-   Stm32Can::GetInterface(0)->Send(0x20A, (uint32_t *)bytes, 6);
+   SendStatic(staticFrames[FRM_20A]);
+   return true;
 }
 
-void PCSCan::Msg212()
+bool PCSCan::Msg212(const ControlInputs&)
 { // BMS status. Static msg
-   uint8_t bytes[8];
-   bytes[0] = 0xB9;
-   bytes[1] = 0x1C;
-   bytes[2] = 0x94;
-   bytes[3] = 0xAD;
-   bytes[4] = 0xC3;
-   bytes[5] = 0x15;
-   bytes[6] = 0x06;
-   bytes[7] = 0x63;
-   Stm32Can::GetInterface(0)->Send(0x212, (uint32_t *)bytes, 8);
+   SendStatic(staticFrames[FRM_212]);
+   return true;
 }
 
-void PCSCan::Msg21D()
+bool PCSCan::Msg21D(const ControlInputs& in)
 {
    // CP EVSE Status. Populate with Cable lim and pilot lim? I think PCS does not care about Limits here in certain firmware.
    uint8_t bytes[8];
 
-   bytes[0] = Param::GetInt(Param::modelcode) ? 0x5D : 0x2D; // 2D FOR EU TYPE 2, 5D FOR US TYPE 1 INPUTS
-   bytes[1] = Param::GetInt(Param::iaclim) * 2;              // pilot current. 8 bits. scale 0.5.
+   bytes[0] = in.usInlet ? 0x5D : 0x2D; // 2D FOR EU TYPE 2, 5D FOR US TYPE 1 INPUTS
+   bytes[1] = in.pilotLim;              // pilot current. 8 bits. scale 0.5.
    bytes[2] = 0x00;
-   bytes[3] = Param::GetInt(Param::iaclim); // cable current limit. scale 1. 7 bits. 0x20=32Amps
+   bytes[3] = in.iaclim; // cable current limit. scale 1. 7 bits. 0x20=32Amps
    bytes[4] = 0x80;
    bytes[5] = 0x00;
    bytes[6] = 0x60;
    bytes[7] = 0x10;
-   Stm32Can::GetInterface(0)->Send(0x21D, (uint32_t *)bytes, 8);
+   SendFrame(0x21D, (uint32_t *)bytes, 8);
+   return true;
 }
 
-void PCSCan::Msg22A()
+bool PCSCan::Msg22A(const ControlInputs& in)
 {
    // HVP PCS control.
-   uint8_t activate = Param::GetInt(Param::activate);
+   uint8_t activate = in.activate;
    uint8_t bytes[4];
    bytes[0] = 0x00; // precharge request voltage. 16 bit signed int. scale 0.1. Bytes 0 and 1.
    bytes[1] = 0x00;
@@ -388,53 +489,41 @@ void PCSCan::Msg22A()
    if (activate == EN_BOTH)
       bytes[2] = (HVVolts & 0xF) << 4 | 0xD; // Charger en and DCDC en
    bytes[3] = (HVVolts >> 4) & 0xFF;         // 0x17;//Measured hv voltage. 0x177 = 375v.
-   Stm32Can::GetInterface(0)->Send(0x22A, (uint32_t *)bytes, 4);
+   SendFrame(0x22A, (uint32_t *)bytes, 4);
+   return true;
 }
 
-void PCSCan::Msg232()
+bool PCSCan::Msg232(const ControlInputs&)
 {
    // BMS Contactor request.Static msg.
-   uint8_t bytes[8];
-   bytes[0] = 0x0A;
-   bytes[1] = 0x02;
-   bytes[2] = 0xD5;
-   bytes[3] = 0x09;
-   bytes[4] = 0xCB;
-   bytes[5] = 0x04;
-   bytes[6] = 0x00;
-   bytes[7] = 0x00;
-   Stm32Can::GetInterface(0)->Send(0x232, (uint32_t *)bytes, 8);
+   SendStatic(staticFrames[FRM_232]);
+   return true;
 }
 
-void PCSCan::Msg23D()
+bool PCSCan::Msg23D(const ControlInputs& in)
 {
    // CP Charge Status
    uint8_t bytes[4];
-   ACILim = Param::GetInt(Param::iaclim) * 2;
 
-   bytes[0] = Param::GetInt(Param::chargerEnable) ? 0x05 : 0x0A; // 0x05 if enabled, else 0x0A
-   bytes[1] = ACILim;                                            // charge current limit. gain 0.5. 0x40 = 64 dec =32A. Populate AC lim in here.
+   bytes[0] = in.chargerEnable ? 0x05 : 0x0A; // 0x05 if enabled, else 0x0A
+   bytes[1] = in.pilotLim;                    // charge current limit. gain 0.5. 0x40 = 64 dec =32A. Populate AC lim in here.
    bytes[2] = 0xFF;                                              // Internal max current limit.
    bytes[3] = 0x0F;
-   Stm32Can::GetInterface(0)->Send(0x23D, (uint32_t *)bytes, 4);
+   SendFrame(0x23D, (uint32_t *)bytes, 4);
+   return true;
 }
 
-void PCSCan::Msg25D()
+bool PCSCan::Msg25D(const ControlInputs& in)
 {
    // CP Status. Only byte 0 bits 0 and 1 are important to the PCS
-   uint8_t bytes[8];
-   bytes[0] = Param::GetInt(Param::modelcode) ? 0xD8 : 0xD9; // D9 FOR EU, D8 FOR US. 1 "CP_TYPE_EURO_IEC" 2 "CP_TYPE_GB" 3 "CP_TYPE_IEC_CCS" 0 "CP_TYPE_US_TESLA" 
-   bytes[1] = 0x8C;
-   bytes[2] = 0x01;
-   bytes[3] = 0xB5;
-   bytes[4] = 0x4A;
-   bytes[5] = 0xC1;
-   bytes[6] = 0x0A;
-   bytes[7] = 0xE0;
-   Stm32Can::GetInterface(0)->Send(0x25D, (uint32_t *)bytes, 8);
+   // D9 FOR EU, D8 FOR US. 1 "CP_TYPE_EURO_IEC" 2 "CP_TYPE_GB" 3 "CP_TYPE_IEC_CCS" 0 "CP_TYPE_US_TESLA"
+   const StaticFrame& f = staticFrames[FRM_25D];
+   uint32_t data[2] = { f.data[0] | (in.usInlet ? 0xD8 : 0xD9), f.data[1] };
+   SendFrame(f.id, data, f.len);
+   return true;
 }
 
-void PCSCan::Msg2B2(uint16_t Charger_Power)
+void PCSCan::Msg2B2(const ControlInputs& in, uint16_t Charger_Power)
 {
    // Charge Power Request
    PCS_Power_Req = Charger_Power; // in Watts
@@ -444,10 +533,10 @@ void PCSCan::Msg2B2(uint16_t Charger_Power)
                         // A missmatch here will trigger a can rationality error.
       bytes[0] = PCS_Power_Req & 0xFF; // KW scale 0.001 16 bit unsigned in bytes 0 and 1. e.g. 0x0578 = 1400 dec = 1400Watts=1.4kW.
       bytes[1] = PCS_Power_Req >> 8;
-      bytes[2] = Param::GetInt(Param::chargerEnable) ? 0x02 : 0x00; // 0x02 if enabled, else 0x00
+      bytes[2] = in.chargerEnable ? 0x02 : 0x00; // 0x02 if enabled, else 0x00
       bytes[3] = 0x00;
       bytes[4] = 0x00;
-      Stm32Can::GetInterface(0)->Send(0x2B2, (uint32_t *)bytes, 5);
+      SendFrame(0x2B2, (uint32_t *)bytes, 5);
    }
    else
    {
@@ -455,213 +544,173 @@ void PCSCan::Msg2B2(uint16_t Charger_Power)
       // A missmatch here will trigger a can rationality error.
       bytes[0] = PCS_Power_Req & 0xFF; // KW scale 0.001 16 bit unsigned in bytes 0 and 1. e.g. 0x0578 = 1400 dec = 1400Watts=1.4kW.
       bytes[1] = PCS_Power_Req >> 8;
-      bytes[2] = Param::GetInt(Param::chargerEnable) ? 0x02 : 0x00; // 0x02 if enabled, else 0x00
-      Stm32Can::GetInterface(0)->Send(0x2B2, (uint32_t *)bytes, 3);
+      bytes[2] = in.chargerEnable ? 0x02 : 0x00; // 0x02 if enabled, else 0x00
+      SendFrame(0x2B2, (uint32_t *)bytes, 3);
    }
 }
 
-void PCSCan::Msg321()
+bool PCSCan::Msg321(const ControlInputs&)
 {
-   uint8_t bytes[8]; // VCFront sensors. Static.
-   bytes[0] = 0x2C;
-   bytes[1] = 0xB6;
-   bytes[2] = 0xA8;
-   bytes[3] = 0x7F;
-   bytes[4] = 0x02;
-   bytes[5] = 0x7F;
-   bytes[6] = 0x00;
-   bytes[7] = 0x00;
-   Stm32Can::GetInterface(0)->Send(0x321, (uint32_t *)bytes, 8);
+   // VCFront sensors. Static.
+   SendStatic(staticFrames[FRM_321]);
+   return true;
 }
 
-void PCSCan::Msg333()
+bool PCSCan::Msg333(const ControlInputs&)
 {
-   uint8_t bytes[4]; // UI charge request message. Can be used as an ac current limit.
-   bytes[0] = 0x04;  // leaving at 48A for now.
-   bytes[1] = 0x30;  // byte one. 7 bits scale 1. 0x30=48A.
-   bytes[2] = 0x29;
-   bytes[3] = 0x07;
-   Stm32Can::GetInterface(0)->Send(0x333, (uint32_t *)bytes, 4);
+   // UI charge request message. Can be used as an ac current limit.
+   // Leaving at 48A for now, byte one. 7 bits scale 1. 0x30=48A.
+   SendStatic(staticFrames[FRM_333]);
+   return true;
 }
 
-void PCSCan::Msg3A1()
+bool PCSCan::Msg3A1(const ControlInputs& in)
 {
-   DCDCSpnt = Param::GetFloat(Param::udcdc) * 100.0f;
-   uint8_t bytes[8]; // VCFront vehicle status
-   bytes[0] = 0x09;  // This message contains the 12v dcdc target setpoint. bits 16-26 as an 11bit unsigned int. scale 0.01
-   bytes[1] = 0x62;
-   bytes[2] = DCDCSpnt & 0xFF;          // 78 , d gives us a 14v target.
-   bytes[3] = ((DCDCSpnt >> 8) | 0x99); // 0x9D;
-   bytes[4] = 0x08;
-   bytes[5] = 0x2C;
-   bytes[6] = 0x12;
-   bytes[7] = 0x5A;
-   Stm32Can::GetInterface(0)->Send(0x3A1, (uint32_t *)bytes, 8);
+   // VCFront vehicle status. This message contains the 12v dcdc target setpoint.
+   // bits 16-26 as an 11bit unsigned int. scale 0.01. 0x578 gives us a 14v target.
+   const StaticFrame& f = staticFrames[FRM_3A1];
+   uint32_t spnt = in.dcdcSpnt;
+   uint32_t data[2] = { f.data[0] | (spnt & 0xFF) << 16 | ((spnt >> 8) & 0xFF) << 24, f.data[1] };
+   SendFrame(f.id, data, f.len);
+   return true;
 }
 
-void PCSCan::Msg3B2()
+bool PCSCan::Msg3B2(const ControlInputs&)
 {
-   uint8_t bytes[8]; // This msg changed drastically between 2019 and 2020-2021 model firmwares. PCS pays close attention to these two muxes.
-   if (mux3b2)       // BMS log2 message
-   {
-      bytes[0] = 0xE5; // mux 5=charging.
-      bytes[1] = 0x0D;
-      bytes[2] = 0xEB;
-      bytes[3] = 0xFF;
-      bytes[4] = 0x0C;
-      bytes[5] = 0x66;
-      bytes[6] = 0xBB;
-      bytes[7] = 0x11;
-      Stm32Can::GetInterface(0)->Send(0x3B2, (uint32_t *)bytes, 8);
-      mux3b2 = false;
-   }
-   else
-   {
-      bytes[0] = 0xE3; // mux 3=charge termination
-      bytes[1] = 0x5D;
-      bytes[2] = 0xFB;
-      bytes[3] = 0xFF;
-      bytes[4] = 0x0C;
-      bytes[5] = 0x66;
-      bytes[6] = 0xBB;
-      bytes[7] = 0x06;
-      Stm32Can::GetInterface(0)->Send(0x3B2, (uint32_t *)bytes, 8);
-      mux3b2 = true;
-   }
+   // This msg changed drastically between 2019 and 2020-2021 model firmwares. PCS pays close attention to these two muxes.
+   SendStatic(staticFrames[mux3b2 ? FRM_3B2_CHARGING : FRM_3B2_TERMINATION]);
+   mux3b2 = !mux3b2;
+   return true;
 }
 
-void PCSCan::Msg221() // VCFRONT_LVPowerState. Payloads captured from a Model 3; mux0 and mux1 share a counter value.
+bool PCSCan::Msg221(const ControlInputs&) // VCFRONT_LVPowerState. Payloads captured from a Model 3; mux0 and mux1 share a counter value.
 {
-   uint8_t bytes[8];
    if (mux221) // index 1, carries pcsLVState = LV_ON
    {
-      bytes[0] = 0x41;
-      bytes[1] = 0x01;
-      bytes[2] = 0x05;
-      bytes[3] = 0x00;
-      bytes[4] = 0x00;
-      bytes[5] = 0x00;
-      bytes[6] = (Count221 << 5);
-      bytes[7] = CalcPCSChecksum((uint8_t *)bytes, 0x221);
-      Stm32Can::GetInterface(0)->Send(0x221, (uint32_t *)bytes, 8);
+      SendCounted(staticFrames[FRM_221_MUX1], Count221 << 5);
       mux221 = false;
    }
    else // index 0
    {
-      bytes[0] = 0x40;
-      bytes[1] = 0x41;
-      bytes[2] = 0x05;
-      bytes[3] = 0x15;
-      bytes[4] = 0x00;
-      bytes[5] = 0x50;
-      bytes[6] = (Count221 << 5) | 0x11;
-      bytes[7] = CalcPCSChecksum((uint8_t *)bytes, 0x221);
-      Stm32Can::GetInterface(0)->Send(0x221, (uint32_t *)bytes, 8);
+      SendCounted(staticFrames[FRM_221_MUX0], Count221 << 5);
       mux221 = true;
       Count221++;
       if (Count221 > 0x07)
          Count221 = 0;
    }
+   return true;
 }
 
-void PCSCan::Msg2D1() // VCFRONT_okToUseHighPower, all consumers permitted
+bool PCSCan::Msg2D1(const ControlInputs&) // VCFRONT_okToUseHighPower, all consumers permitted
 {
-   uint8_t bytes[8] = {0};
-   bytes[0] = 0xFF;
-   bytes[1] = 0x01;
-   Stm32Can::GetInterface(0)->Send(0x2D1, (uint32_t *)bytes, 2);
+   SendStatic(staticFrames[FRM_2D1]);
+   return true;
 }
 
-void PCSCan::Msg545()
+bool PCSCan::Msg545(const ControlInputs&)
 {
-   uint8_t bytes[8];
-   if (mux545) // VCFront
-   {
-      bytes[0] = 0x14;
-      bytes[1] = 0x00;
-      bytes[2] = 0x3F;
-      bytes[3] = 0x70;
-      bytes[4] = 0x9F;
-      bytes[5] = 0x01;
-      bytes[6] = (Count545 << 4) | 0xA;
-      bytes[7] = CalcPCSChecksum((uint8_t *)bytes, 0x545);
-      Stm32Can::GetInterface(0)->Send(0x545, (uint32_t *)bytes, 8);
-      mux545 = false;
-   }
-   else
-   {
-      bytes[0] = 0x03;
-      bytes[1] = 0x19;
-      bytes[2] = 0x64;
-      bytes[3] = 0x32;
-      bytes[4] = 0x19;
-      bytes[5] = 0x00;
-      bytes[6] = (Count545 << 4);
-      bytes[7] = CalcPCSChecksum((uint8_t *)bytes, 0x545);
-      Stm32Can::GetInterface(0)->Send(0x545, (uint32_t *)bytes, 8);
-      mux545 = true;
-   }
+   // VCFront, two muxes that both carry the counter
+   SendCounted(staticFrames[mux545 ? FRM_545_MUX_A : FRM_545_MUX_B], Count545 << 4);
+   mux545 = !mux545;
    Count545++;
    if (Count545 > 0x0F)
       Count545 = 0;
+   return true;
 }
 
-void PCSCan::AlertHandler() // Publish the live active-alert set (from 0x3A4) as 4 combined flag fields
+///////////////////////////////////////////////////////////////////////////////////////
+///////Logger frames, all fields little endian
+///////////////////////////////////////////////////////////////////////////////////////
+
+// Counts the scheduler calls of each frame down to its configured interval
+static bool LogFrameDue(PCSCan::LogFrame frame, Param::PARAM_NUM interval)
 {
-   // 102 alerts can't fit one fixed-point flag field (s32fp caps usable flags at bit 25), so the
-   // active set is packed into four 26-bit groups. Flag value for alert N in group G is
-   // 1 << ((N-1) % 26); the web UI renders each group combined as "a | b | c".
-   int32_t grp[4] = {0, 0, 0, 0};
-   uint8_t count = 0;
-   for (uint8_t id = 1; id <= 102; id++)
+   static uint16_t elapsed[PCSCan::LOG_LAST];
+
+   if ((Param::GetInt(Param::canlogen) & (1 << frame)) == 0)
    {
-      if (pcs_alert_active[id])
-      {
-         grp[(id - 1) / 26] |= 1 << ((id - 1) % 26);
-         count++;
-      }
+      elapsed[frame] = 0;
+      return false;
    }
-   Param::SetInt(Param::PCSAlerts1, grp[0]); // alerts 1-26
-   Param::SetInt(Param::PCSAlerts2, grp[1]); // alerts 27-52
-   Param::SetInt(Param::PCSAlerts3, grp[2]); // alerts 53-78
-   Param::SetInt(Param::PCSAlerts4, grp[3]); // alerts 79-102
-   Param::SetInt(Param::PCSAlertCnt, count);
 
-   // Legacy 0x424 log display (kept for reference; do not remove yet):
-   // Param::SetInt(Param::PCSAlerts, pcs_alert_matrix[Param::GetInt(Param::Alerts)]);
-   // if (!Param::GetBool(Param::AlertLog))
-   // {
-   //    PCS_AlertCnt = 0;
-   //    Param::SetInt(Param::PCSAlertCnt, PCS_AlertCnt);
-   //    for (int i = 0; i < 10; i++)
-   //       pcs_alert_matrix[i] = 0; // Clear log and counter when PCS alert logging disabled
-   // }
+   elapsed[frame] += PCSCan::LOG_PERIOD_MS;
+   if (elapsed[frame] < Param::GetInt(interval)) return false;
+
+   elapsed[frame] = 0;
+   return true;
+}
+
+// value * mul + offset as integer, saturated to the range of its field
+static uint32_t LogField(s32fp value, int32_t mul, int32_t offset, int32_t min, int32_t max)
+{
+   int32_t v = FP_TOINT(value * mul) + offset;
+   return (uint32_t)(v < min ? min : v > max ? max : v);
+}
+
+static void SendLogFrame(PCSCan::LogFrame frame, uint32_t data[2])
+{
+   SendFrame(Param::GetInt(Param::canlogid) + frame, data, 8);
+}
+
+bool PCSCan::MsgLogHv(const ControlInputs&)
+{
+   // udc 0.1V, idc 0.1A signed, uac 0.1V, iac 0.1A
+   if (!LogFrameDue(LOG_HV, Param::canlogfast)) return false;
+
+   uint32_t data[2] =
+   {
+      LogField(Param::Get(Param::udc), 10, 0, 0, 0xFFFF) | (LogField(Param::Get(Param::idc), 10, 0, -32768, 32767) & 0xFFFF) << 16,
+      LogField(Param::Get(Param::uac), 10, 0, 0, 0xFFFF) | LogField(Param::Get(Param::iac), 10, 0, 0, 0xFFFF) << 16
+   };
+   SendLogFrame(LOG_HV, data);
+   return true;
 }
 
-static uint8_t CalcPCSChecksum(uint8_t *bytes, uint16_t id)
+bool PCSCan::MsgLogLv(const ControlInputs&)
 {
-   uint16_t checksum_calc = 0;
-   for (int b = 0; b < 7; b++)
+   // Output current of charger phase A, B, C 0.1A, ulv 0.01V, idcdc 0.1A, powerac 0.1kW
+   if (!LogFrameDue(LOG_LV, Param::canlogfast)) return false;
+
+   uint32_t ulv = LogField(Param::Get(Param::ulv), 100, 0, 0, 0xFFFF);
+   uint32_t data[2] =
    {
-      checksum_calc = checksum_calc + bytes[b];
-   }
-   checksum_calc += id + (id >> 8);
-   checksum_calc &= 0xFF;
+      LogField(IOut_PhA, 10, 0, 0, 0xFF) | LogField(IOut_PhB, 10, 0, 0, 0xFF) << 8 | LogField(IOut_PhC, 10, 0, 0, 0xFF) << 16 | (ulv & 0xFF) << 24,
+      ulv >> 8 | LogField(Param::Get(Param::idcdc), 10, 0, 0, 0xFFFF) << 8 | LogField(Param::Get(Param::powerac), 10, 0, 0, 0xFF) << 24
+   };
+   SendLogFrame(LOG_LV, data);
+   return true;
+}
+
+bool PCSCan::MsgLogTemp(const ControlInputs&)
+{
+   // ChgATemp, ChgBTemp, ChgCTemp, DCDCTemp, DCDCBTemp, PCSAmbTemp 1C offset -40, CHG_STAT, PCSAlertCnt
+   if (!LogFrameDue(LOG_TEMP, Param::canlogslow)) return false;
 
-   return (uint8_t)checksum_calc;
+   uint32_t data[2] =
+   {
+      LogField(Param::Get(Param::ChgATemp), 1, 40, 0, 0xFF) | LogField(Param::Get(Param::ChgBTemp), 1, 40, 0, 0xFF) << 8 |
+      LogField(Param::Get(Param::ChgCTemp), 1, 40, 0, 0xFF) << 16 | LogField(Param::Get(Param::DCDCTemp), 1, 40, 0, 0xFF) << 24,
+      LogField(Param::Get(Param::DCDCBTemp), 1, 40, 0, 0xFF) | LogField(Param::Get(Param::PCSAmbTemp), 1, 40, 0, 0xFF) << 8 |
+      LogField(Param::Get(Param::CHG_STAT), 1, 0, 0, 0xFF) << 16 | LogField(Param::Get(Param::PCSAlertCnt), 1, 0, 0, 0xFF) << 24
+   };
+   SendLogFrame(LOG_TEMP, data);
+   return true;
 }
 
-static int16_t ProcessTemps(uint16_t InVal)
+bool PCSCan::MsgLogEnergy(const ControlInputs&)
 {
-   int16_t value = InVal & 0x3ff;
-   if (InVal & 0x400)
-      value -= 0x3ff;
-   value = value * 0.1 + 40;
-   value = InVal & 0x3ff;
-   if (InVal & 0x400)
-      value -= 0x3ff;
-   value = value * 0.1 + 40;
-   return value;
+   // PCSAcKWh 0.01kWh 24 bit, PCSDcdcKWh 0.01kWh 24 bit, powerdcdc 1W.
+   // PCSBattKWh is derived from the two counters and left to the logger.
+   if (!LogFrameDue(LOG_ENERGY, Param::canlogslow)) return false;
+
+   uint32_t dcdcKWh = LogField(Param::Get(Param::PCSDcdcKWh), 100, 0, 0, 0xFFFFFF);
+   uint32_t data[2] =
+   {
+      LogField(Param::Get(Param::PCSAcKWh), 100, 0, 0, 0xFFFFFF) | (dcdcKWh & 0xFF) << 24,
+      dcdcKWh >> 8 | LogField(Param::Get(Param::powerdcdc), 1, 0, 0, 0xFFFF) << 16
+   };
+   SendLogFrame(LOG_ENERGY, data);
+   return true;
 }
 
 static void ProcessCANRat(uint16_t AlertCANId, uint8_t AlertRxError)
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "busstats.h"
+#include "params.h"
+
+#define FIXED_BITS      13   // CRC delimiter, ACK slot and delimiter, EOF, interframe space
+#define STUFFED_BITS    34   // SOF, ID, RTR, IDE, r0, DLC, CRC
+
+// Worst case: a stuff bit after the first 5 equal bits and then after every 4 more
+#define FRAME_BITS(dlc) (STUFFED_BITS + 8 * (dlc) + FIXED_BITS + (STUFFED_BITS + 8 * (dlc) - 1) / 4)
+
+// Indexed by DLC, so the interrupts only look up the length of a frame
+static const uint8_t frameBits[9] =
+{
+   FRAME_BITS(0), FRAME_BITS(1), FRAME_BITS(2), FRAME_BITS(3), FRAME_BITS(4),
+   FRAME_BITS(5), FRAME_BITS(6), FRAME_BITS(7), FRAME_BITS(8)
+};
+
+BusStats::Entry BusStats::table[TABLE_SIZE];
+uint32_t BusStats::windowBits[10];
+uint8_t BusStats::window = 0;
+uint32_t BusStats::untracked = 0;
+
+uint32_t BusStats::FrameBits(uint8_t dlc)
+{
+   return frameBits[dlc > 8 ? 8 : dlc];
+}
+
+void BusStats::Init()
+{
+   for (int i = 0; i < TABLE_SIZE; i++)
+      table[i].id = EMPTY_ID;
+}
+
+BusStats::Entry* BusStats::Lookup(uint32_t id)
+{
+   uint16_t key = id & 0x7FF;
+
+   for (int probe = 0, i = (key ^ (key >> 6)) % TABLE_SIZE; probe < TABLE_SIZE; probe++, i = (i + 1) % TABLE_SIZE)
+   {
+      if (table[i].id == key) return &table[i];
+
+      if (table[i].id == EMPTY_ID)
+      {
+         table[i].id = key;
+         return &table[i];
+      }
+   }
+   untracked++;
+   return 0;
+}
+
+void BusStats::CountRx(uint32_t id, uint8_t dlc)
+{
+   uint32_t bits = FrameBits(dlc);
+   Entry* e = Lookup(id);
+
+   windowBits[window] += bits;
+   if (e == 0) return;
+
+   e->rxFrames++;
+   e->rxBits += bits;
+   e->windowBits += bits;
+}
+
+void BusStats::CountTx(uint32_t id, uint8_t dlc)
+{
+   uint32_t bits = FrameBits(dlc);
+   Entry* e = Lookup(id);
+
+   windowBits[window] += bits;
+   if (e == 0) return;
+
+   e->txFrames++;
+   e->txBits += bits;
+   e->windowBits += bits;
+}
+
+void BusStats::Update()
+{
+   uint32_t total = 0;
+
+   for (int i = 0; i < 10; i++)
+      total += windowBits[i];
+
+   // Percent of the bit rate over the last second
+   Param::SetFixed(Param::busload, FP_FROMINT(total) / (BITRATE / 100));
+
+   window = (window + 1) % 10;
+   windowBits[window] = 0;
+
+   if (window != 0) return;
+
+   // Once per second close the per-ID windows and rank them
+   int top[TOP_N];
+
+   for (int n = 0; n < TOP_N; n++)
+      top[n] = -1;
+
+   for (int i = 0; i < TABLE_SIZE; i++)
+   {
+      Entry& e = table[i];
+
+      if (e.id == EMPTY_ID) continue;
+
+      e.lastBits = e.windowBits;
+      e.windowBits = 0;
+
+      for (int n = 0; n < TOP_N; n++)
+      {
+         if (top[n] < 0 || e.lastBits > table[top[n]].lastBits)
+         {
+            for (int m = TOP_N - 1; m > n; m--)
+               top[m] = top[m - 1];
+            top[n] = i;
+            break;
+         }
+      }
+   }
+
+   for (int n = 0; n < TOP_N; n++)
+   {
+      bool valid = top[n] >= 0 && table[top[n]].lastBits > 0;
+      Param::SetInt((Param::PARAM_NUM)(Param::busid1 + 2 * n), valid ? table[top[n]].id : 0);
+      Param::SetFixed((Param::PARAM_NUM)(Param::busld1 + 2 * n), valid ? FP_FROMINT(table[top[n]].lastBits) / (BITRATE / 100) : 0);
+   }
+}
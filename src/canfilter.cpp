@@ -0,0 +1,140 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/stm32/can.h>
+#include "canfilter.h"
+
+// 16-bit filter register: STDID[10:0] in bits 15:5, then RTR and IDE.
+// Requiring RTR and IDE to be 0 restricts mask filters to standard data frames like the list filters.
+#define FILTER_ID(id)        ((uint16_t)((id) << 5))
+#define FILTER_MASK(care)    ((uint16_t)(((care) << 5) | 0x18))
+#define STDID_BITS           0x7FF
+
+struct Cube
+{
+   uint16_t id;
+   uint16_t dontCare;
+};
+
+/* Repeatedly merge pairs of equal shape that differ in exactly one bit,
+ * so every resulting id/mask pair matches exactly the ids it replaced */
+static int MergeIds(const uint16_t* ids, int count, Cube* cubes)
+{
+   int n = 0;
+
+   for (int i = 0; i < count; i++)
+   {
+      bool dup = false;
+      for (int j = 0; j < n; j++) dup |= cubes[j].id == ids[i];
+      if (!dup)
+      {
+         cubes[n].id = ids[i] & STDID_BITS;
+         cubes[n].dontCare = 0;
+         n++;
+      }
+   }
+
+   for (bool merged = true; merged;)
+   {
+      merged = false;
+
+      for (int i = 0; i < n; i++)
+      {
+         for (int j = i + 1; j < n; j++)
+         {
+            uint16_t diff = cubes[i].id ^ cubes[j].id;
+
+            if (cubes[i].dontCare == cubes[j].dontCare && diff != 0 && (diff & (diff - 1)) == 0)
+            {
+               cubes[i].id &= ~diff;
+               cubes[i].dontCare |= diff;
+               cubes[j] = cubes[--n];
+               merged = true;
+            }
+         }
+      }
+   }
+   return n;
+}
+
+int CanFilter::Plan(const uint16_t* ids, int count, Bank* banks, int maxBanks)
+{
+   Cube cubes[MAX_IDS];
+   uint16_t singles[MAX_IDS];
+   Cube pairs[MAX_IDS];
+   int numSingles = 0, numPairs = 0, numBanks = 0;
+
+   if (count > MAX_IDS) return -1;
+
+   int n = MergeIds(ids, count, cubes);
+
+   for (int i = 0; i < n; i++)
+   {
+      if (cubes[i].dontCare) pairs[numPairs++] = cubes[i];
+      else singles[numSingles++] = cubes[i].id;
+   }
+
+   // An odd number of pairs leaves a mask slot free, a single id can use it with all bits cared for
+   if ((numPairs & 1) && numSingles > 0)
+   {
+      pairs[numPairs].id = singles[--numSingles];
+      pairs[numPairs].dontCare = 0;
+      numPairs++;
+   }
+
+   for (int i = 0; i < numPairs; i += 2, numBanks++)
+   {
+      if (numBanks >= maxBanks) return -1;
+      // Unused second slot repeats the first one rather than accepting ID 0
+      const Cube& b = pairs[i + 1 < numPairs ? i + 1 : i];
+      banks[numBanks].isMask = true;
+      banks[numBanks].reg[0] = FILTER_ID(pairs[i].id);
+      banks[numBanks].reg[1] = FILTER_MASK(STDID_BITS & ~pairs[i].dontCare);
+      banks[numBanks].reg[2] = FILTER_ID(b.id);
+      banks[numBanks].reg[3] = FILTER_MASK(STDID_BITS & ~b.dontCare);
+   }
+
+   for (int i = 0; i < numSingles; i += 4, numBanks++)
+   {
+      if (numBanks >= maxBanks) return -1;
+      banks[numBanks].isMask = false;
+      for (int j = 0; j < 4; j++)
+         banks[numBanks].reg[j] = FILTER_ID(singles[i + j < numSingles ? i + j : numSingles - 1]);
+   }
+
+   return numBanks;
+}
+
+int CanFilter::Apply(const uint16_t* ids, int count, uint32_t fifo, int firstBank)
+{
+   Bank banks[TOP_BANK + 1];
+   int numBanks = Plan(ids, count, banks, firstBank + 1);
+
+   for (int i = 0; i < numBanks; i++)
+   {
+      const uint16_t* r = banks[i].reg;
+
+      if (banks[i].isMask)
+         can_filter_id_mask_16bit_init(firstBank - i, r[0], r[1], r[2], r[3], fifo, true);
+      else
+         can_filter_id_list_16bit_init(firstBank - i, r[0], r[1], r[2], r[3], fifo, true);
+   }
+
+   return numBanks > 0 ? firstBank - numBanks : firstBank;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "changelog.h"
+
+s32fp ChangeLog::last[Param::PARAM_LAST];
+uint32_t ChangeLog::changed[Param::PARAM_LAST];
+uint32_t ChangeLog::sequence = 1;
+
+void ChangeLog::Init(uint16_t boot)
+{
+   sequence = ((uint32_t)boot << 16) | 1;
+
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+   {
+      last[i] = Param::Get((Param::PARAM_NUM)i);
+      changed[i] = sequence;
+   }
+}
+
+uint32_t ChangeLog::Scan()
+{
+   bool any = false;
+
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+   {
+      s32fp value = Param::Get((Param::PARAM_NUM)i);
+
+      if (value == last[i]) continue;
+
+      // All changes found by one scan share one number
+      if (!any) sequence++;
+      any = true;
+      last[i] = value;
+      changed[i] = sequence;
+   }
+   return sequence;
+}
@@ -0,0 +1,391 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2020 Johannes Huebner <dev@johanneshuebner.com>
+ *               2025 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/stm32/rtc.h>
+#include "chargecontrol.h"
+#include "PCSCan.h"
+#include "digio.h"
+#include "pcssignal.h"
+#include "canrxring.h"
+#include "timebase.h"
+#include "pcsshadow.h"
+#include "journal.h"
+#include "busstats.h"
+#include "latency.h"
+#include "profiler.h"
+
+static uint32_t startTime;
+static bool CAN_Enable = false;
+static uint16_t ChgPower = 0;
+static bool ZeroPower = false;
+
+// Charge power request ramp (0x2B2), stepped once per periodic 0x2B2 frame (100ms).
+// DO NOT EVER TOUCH THE RAMP TIME!!!! CHARGER WILL NOT ACCEPT ANY FASTER!!!
+#define CHG_PWR_RAMP_UP 10 // W per 100ms ramping towards a higher setpoint (100W/s)
+#define CHG_PWR_RAMP_DN 10 // W per 100ms easing towards a lower setpoint (100W/s)
+
+// VCU status-bit (0x108) fault detection: debounce counters, ticked once per Ms100Task cycle (100ms).
+#define PCS_MIA_TIMEOUT_TICKS 10  // 1.0s without a 0x204/0x2B4 frame -> PCS presumed unreachable
+#define DCDC_FAULT_TICKS      30  // 3.0s of zero DC-DC output current while DC-DC is commanded on
+#define CHG_FAULT_TICKS       150 // 15s of zero charger output current while charging is commanded
+static uint16_t rx204Age = 0;            // ticks since last 0x204 (PCS charge status) frame
+static uint16_t rx2B4Age = 0;            // ticks since last 0x2B4 (PCS DC-DC status) frame
+static uint16_t dcdcZeroCurrentTicks = 0;
+static uint16_t chgZeroCurrentTicks = 0;
+static uint8_t lastVcuFaults = 0;        // 0x108 fault bits last written to the journal
+static volatile uint32_t vcuStatus;      // 0x108 payload, packed in the main loop
+static volatile uint32_t ms100Ticks;     // Run() calls, for the deferred debounce
+
+// Frames queued by the CAN RX interrupt, decoded at the start of Ms10Task.
+// 32 slots cover well over one 10ms period of full PCS logging traffic.
+static CanRxRing<32> rxRing;
+
+// Reaction to a VCU mode change: from the 0x109 interrupt to the pin writes and to
+// the first 0x22A/0x2B2 that carries it. The pins change in Ms10Task, the frame
+// follows in the next TX slot. Each 0x109 is timed from its own reception, the time
+// travels with the frame through the RX ring.
+static uint32_t txLatencyStart;         // 0x109 receive time of a pending TX measurement, 0 = none
+static LatencyStat txLatency(Param::lattxmin);
+static LatencyStat ioLatency(Param::latiomin);
+
+// 0x109 VCU charge request
+typedef CanSignal<0,  8>  VCU_opmode;
+typedef CanSignal<24, 16> VCU_udcSetpoint;   // V
+typedef CanSignal<40, 16> VCU_pacSetpoint;   // W
+typedef CanSignal<56, 4>  VCU_acCurrentLim;  // 0..15 -> 1..16A
+typedef CanSignal<60, 4>  VCU_chargerCmd;    // 0xA = enable, 0xC = disable
+
+enum { VCU_OPMODE = 1, VCU_CHGENABLE = 2 };
+
+// Returns the VCU_* bits of the requests that changed
+static uint8_t handle109(uint32_t data[2])
+{
+   int lastOpmode = Param::GetInt(Param::opmode);
+   int lastEnable = Param::GetInt(Param::chargerEnable);
+
+   Param::SetInt(Param::opmode, VCU_opmode::Raw(data)); // opmode from VCU
+   Param::SetInt(Param::udcspnt, VCU_udcSetpoint::Raw(data)); // HV voltage setpoint from vcu
+   Param::SetInt(Param::pacspnt, VCU_pacSetpoint::Raw(data)); // max charger power from vcu
+   Param::SetInt(Param::iaclim, VCU_acCurrentLim::Raw(data) + 1); // Map 0–15 to 1–16A
+
+   uint8_t chargerCmd = VCU_chargerCmd::Raw(data);
+   if (chargerCmd == 0xA) Param::SetInt(Param::chargerEnable, 1); // enable/disable request from vcu
+   if (chargerCmd == 0xC) Param::SetInt(Param::chargerEnable, 0);
+
+   return (Param::GetInt(Param::opmode) != lastOpmode ? VCU_OPMODE : 0)
+        | (Param::GetInt(Param::chargerEnable) != lastEnable ? VCU_CHGENABLE : 0);
+}
+
+
+static void ChargerStateMachine(const ControlInputs& in)
+{
+   switch (in.opmode)
+   {
+   case MOD_OFF:
+      ZeroPower = true; // charger power =0 in off.
+      CAN_Enable = false;
+
+      DigIo::pcsena_out.Clear();    // pcs off
+      DigIo::dcdcena_out.Set();     // DC-DC off   
+      DigIo::chena_out.Set();       // PCS off
+      Param::SetInt(Param::activate, EN_NONE);
+      break;
+
+   case MOD_PRECHARGE:
+      break;
+
+   case MOD_RUN:
+      ZeroPower = true; // charger power=0 in drive.
+      CAN_Enable = true;
+
+      DigIo::pcsena_out.Set();      // pcs on
+      DigIo::chena_out.Set();       // charger off
+      DigIo::dcdcena_out.Clear();   // DC-DC on   
+      Param::SetInt(Param::activate, EN_DCDC);   
+      break;
+
+   case MOD_CHARGE:
+      startTime = rtc_get_counter_val();
+      ZeroPower = false;
+      CAN_Enable = true;
+
+      if (!ZeroPower)  DigIo::chena_out.Clear(); // charger on
+      DigIo::pcsena_out.Set(); // pcs on
+      DigIo::dcdcena_out.Clear();   // DC-DC on
+      Param::SetInt(Param::activate, EN_BOTH);
+      break;
+   
+   case MOD_REQUEST_OFF:
+      // Graceful pre-OFF: command the PCS to wind down charger + DC-DC over CAN and
+      // hold here until the VCU opens the contactors / commands MOD_OFF. The PCS
+      // obeys the CAN content, so the enable pins must AGREE with 0x22A / 0x2B2.
+      ZeroPower = true;                        // 0x2B2 charge-power request -> 0
+      CAN_Enable = true;                       // keep the bus fed (no MIA, hears the shutdown)
+      Param::SetInt(Param::activate, EN_NONE); // 0x22A: shut down charger AND DC-DC
+
+      DigIo::pcsena_out.Set();    // keep PCS powered
+      DigIo::dcdcena_out.Set();   // DC-DC disable
+      DigIo::chena_out.Set();     // charger disable
+      break;
+   
+   default:
+      break;
+   }
+}
+
+// step is false for event frames, they only drop the power to zero but never move the ramp
+static uint16_t ChgPwrRamp(const ControlInputs& in, bool step)
+{
+   uint8_t Charger_state = in.chgStat;
+   uint16_t Charger_Pwr_Max = in.pacspnt;
+
+   if (Charger_state != chargerStates::ENABLE)
+      ChgPower = 0; // Set power 0 immediately
+
+   if (ZeroPower)
+      ChgPower = 0;
+   else if (step && ChgPower < Charger_Pwr_Max) // ramp up, clamped so we land exactly on the setpoint
+      ChgPower = (Charger_Pwr_Max - ChgPower > CHG_PWR_RAMP_UP) ? ChgPower + CHG_PWR_RAMP_UP : Charger_Pwr_Max;
+   else if (step && ChgPower > Charger_Pwr_Max) // ease down, clamped so we land exactly on the setpoint
+      ChgPower = (ChgPower - Charger_Pwr_Max > CHG_PWR_RAMP_DN) ? ChgPower - CHG_PWR_RAMP_DN : Charger_Pwr_Max;
+
+   return ChgPower;
+}
+
+// Applies a VCU transition right away instead of at the next Ms100Task.
+// Only opmode moves the enable pins, the charger enable request only changes frames.
+static void VcuTransition(uint8_t changed, uint32_t start)
+{
+   if (changed == 0) return;
+
+   ChargerStateMachine(PCSCan::CaptureInputs());
+   if (changed & VCU_OPMODE)
+      ioLatency.Add(Timebase::Micros() - start);
+   // Nothing goes out while CAN is disabled, so there is no frame to wait for
+   txLatencyStart = CAN_Enable ? start | 1 : 0;
+}
+
+// Closes a pending latency measurement, called after 0x22A and 0x2B2 were sent
+static void TxLatencySent()
+{
+   if (txLatencyStart == 0) return;
+
+   txLatency.Add(Timebase::Micros() - txLatencyStart);
+   txLatencyStart = 0;
+}
+
+// Runs every queued PCS/VCU frame through its decoder. This is the only place
+// the decoders run, so all Param updates from CAN happen in task context.
+// The PCS handlers only update the shadow state, changes are published at the end.
+void ChargeControl::DecodeRxFrames()
+{
+   CanRxFrame f;
+
+   while (rxRing.Pop(f))
+   {
+      uint32_t start = Profiler::Start();
+      int probe;
+
+      switch (f.id)
+      {
+      case 0x204: PCSCan::handle204(f.data); rx204Age = 0; probe = Profiler::PRB_rx204; break; // PCS Charge status
+      case 0x2B4: PCSCan::handle2B4(f.data); rx2B4Age = 0; probe = Profiler::PRB_rx2B4; break; // DCDC info
+      case 0x264: PCSCan::handle264(f.data); probe = Profiler::PRB_rx264; break; // PCS Charge Line Status
+      case 0x2A4: PCSCan::handle2A4(f.data); probe = Profiler::PRB_rx2A4; break; // PCS Temps
+      case 0x2C4: PCSCan::handle2C4(f.data); probe = Profiler::PRB_rx2C4; break; // PCS Logging
+      case 0x3A4: PCSCan::handle3A4(f.data, f.time); probe = Profiler::PRB_rx3A4; break; // PCS Alert Matrix
+      case 0x424: PCSCan::handle424(f.data); probe = Profiler::PRB_rx424; break; // PCS Alert Log
+      case 0x504: PCSCan::handle504(f.data); probe = Profiler::PRB_rx504; break; // PCS Boot ID
+      case 0x76C: PCSCan::handle76C(f.data); probe = Profiler::PRB_rx76C; break; // PCS Debug output
+      case 0x109: VcuTransition(handle109(f.data), f.micros); probe = Profiler::PRB_rx109; break; // VCU charge request and power limits
+      default: continue;
+      }
+      Profiler::Stop(probe, start);
+   }
+
+   PcsShadow::Publish();
+   Param::SetInt(Param::canrxhw, rxRing.GetHighWater());
+   Param::SetInt(Param::canrxdrop, rxRing.GetDrops());
+}
+
+static bool Msg2B2Ramped(const ControlInputs& in)
+{
+   PCSCan::Msg2B2(in, ChgPwrRamp(in, !TxScheduler::IsEventSend()));
+   TxLatencySent();
+   return true;
+}
+
+static bool Msg22ATimed(const ControlInputs& in)
+{
+   PCSCan::Msg22A(in);
+   TxLatencySent();
+   return true;
+}
+
+// Status msg to VCU, packed by PackVcuStatus() and sent from the TX slot table every 100ms
+static bool MsgVcuStatus(const ControlInputs& in)
+{
+   if (in.opmode == MOD_OFF) return false;
+
+   uint32_t data[2] = { vcuStatus, 0 };
+
+   BusStats::CountTx(0x108, 3);
+   Stm32Can::GetInterface(0)->Send(0x108, data, 3);
+   return true;
+}
+
+// Deferred from Ms100Task. The payload is stored as one word so the TX slot never sends half an update.
+void ChargeControl::PackVcuStatus()
+{
+   const ControlInputs in = PCSCan::CaptureInputs();
+
+   if (in.opmode != MOD_OFF)
+   {
+      uint8_t bytes[4] = { 0 };
+
+      // Pack GridCFG (2 bits) and uac (10 bits) into bytes[0] and bytes[1]
+      uint16_t uac = Param::GetInt(Param::uac);
+      uint8_t gridcfg = Param::GetInt(Param::GridCFG) & 0x03;
+
+      // Charger/DC-DC fault: PCS unreachable (no 0x204/0x2B4 for >1s), PCS reports FAULTED (charger
+      // only), or sustained zero output current while that subsystem is actually commanded on.
+      // "Other alert" is a low-detail catch-all for anything not covered by the two bits above.
+      bool chgFault = (rx204Age > PCS_MIA_TIMEOUT_TICKS)
+                    || (in.chgStat == chargerStates::FAULTED)
+                    || (chgZeroCurrentTicks > CHG_FAULT_TICKS);
+      bool dcdcFault = (rx2B4Age > PCS_MIA_TIMEOUT_TICKS)
+                     || (dcdcZeroCurrentTicks > DCDC_FAULT_TICKS);
+      bool otherAlert = Param::GetInt(Param::PCSAlertCnt) > 0;
+      uint8_t vcuFaults = chgFault | (dcdcFault << 1) | (otherAlert << 2);
+
+      if (vcuFaults != lastVcuFaults)
+      {
+         Journal::Log(Journal::REC_VCU_FAULT, vcuFaults);
+         lastVcuFaults = vcuFaults;
+      }
+
+      bytes[0] = (uint8_t)(uac & 0xFF);                    // AC voltage bits 0-7
+      bytes[1] = (uint8_t)((uac >> 8) & 0x03)              // AC voltage bits 8-9 (in byte[1] bits 0-1)
+              | (gridcfg << 2)                              // GridCFG bits 0-1 (in byte[1] bits 2-3)
+              | (chgFault << 4)                             // Charger_Fault (byte[1] bit 4)
+              | (dcdcFault << 5)                            // DCDC_Fault (byte[1] bit 5)
+              | (otherAlert << 6);                          // PCS_Other_Alert (byte[1] bit 6)
+      bytes[2] = (uint8_t)FP_TOINT(Param::Get(Param::CHGPAvail) * 10);
+      vcuStatus = *(uint32_t*)bytes;
+   }
+}
+
+// Everything we transmit periodically. TxScheduler spreads these over its 2ms slot
+// grid, the phase of each message is chosen at startup.
+static const TxSlot txSlots[] =
+{
+   { 0x13D, 10,  PCSCan::Msg13D, true, IN_CHGENABLE | IN_CURRENT },
+   { 0x22A, 10,  Msg22ATimed,    true, IN_ACTIVATE },
+   { 0x3B2, 10,  PCSCan::Msg3B2, true, 0 },
+   { 0x545, 50,  PCSCan::Msg545, true, 0 },
+   // { 0x221, 50,  PCSCan::Msg221, true, 0 }, // VCFRONT emulation, disabled while chasing a charge fault
+   { 0x20A, 100, PCSCan::Msg20A, true, 0 },
+   { 0x212, 100, PCSCan::Msg212, true, 0 },
+   { 0x21D, 100, PCSCan::Msg21D, true, IN_CURRENT },
+   { 0x232, 100, PCSCan::Msg232, true, 0 },
+   { 0x23D, 100, PCSCan::Msg23D, true, IN_CHGENABLE | IN_CURRENT },
+   { 0x25D, 100, PCSCan::Msg25D, true, 0 },
+   { 0x2B2, 100, Msg2B2Ramped,   true, IN_CHGENABLE }, // the periodic frame steps the power ramp, an event frame does not
+   { 0x321, 100, PCSCan::Msg321, true, 0 },
+   { 0x333, 100, PCSCan::Msg333, true, 0 },
+   { 0x3A1, 100, PCSCan::Msg3A1, true, 0 },
+   // { 0x2D1, 100, PCSCan::Msg2D1, true, 0 }, // VCFRONT emulation, disabled while chasing a charge fault
+   { 0x108, 100, MsgVcuStatus,   false, 0 }, // to the VCU, sent whenever we are not off
+   // Logger frames on canlogid + LogFrame. They decimate to their own interval.
+   { TxSlot::ID_CANLOGID + PCSCan::LOG_HV,     PCSCan::LOG_PERIOD_MS, PCSCan::MsgLogHv,     false, 0 },
+   { TxSlot::ID_CANLOGID + PCSCan::LOG_LV,     PCSCan::LOG_PERIOD_MS, PCSCan::MsgLogLv,     false, 0 },
+   { TxSlot::ID_CANLOGID + PCSCan::LOG_TEMP,   PCSCan::LOG_PERIOD_MS, PCSCan::MsgLogTemp,   false, 0 },
+   { TxSlot::ID_CANLOGID + PCSCan::LOG_ENERGY, PCSCan::LOG_PERIOD_MS, PCSCan::MsgLogEnergy, false, 0 },
+};
+
+static uint16_t AddTicks(uint16_t counter, uint32_t ticks)
+{
+   return counter + ticks < 0xFFFF ? counter + ticks : 0xFFFF;
+}
+
+// Deferred from Ms100Task: sustained zero-output conditions for the VCU status bits.
+// Catches up on all ticks since the last run, so a busy main loop delays but never shortens the debounce.
+void ChargeControl::DebounceFaults()
+{
+   static uint32_t lastTick = 0;
+   uint32_t ticks = ms100Ticks - lastTick;
+   const ControlInputs in = PCSCan::CaptureInputs();
+
+   lastTick += ticks;
+
+   bool dcdcCommanded = (in.activate & EN_DCDC) != 0;
+   if (dcdcCommanded && Param::Get(Param::idcdc) <= 0)
+      dcdcZeroCurrentTicks = AddTicks(dcdcZeroCurrentTicks, ticks);
+   else
+      dcdcZeroCurrentTicks = 0;
+
+   bool chgCommanded = in.opmode == MOD_CHARGE
+                     && in.chargerEnable
+                     && in.pacspnt > 0;
+   if (chgCommanded && Param::Get(Param::idc) <= 0)
+      chgZeroCurrentTicks = AddTicks(chgZeroCurrentTicks, ticks);
+   else
+      chgZeroCurrentTicks = 0;
+}
+
+// Interrupt context: only timestamp and queue, decoding happens in DecodeRxFrames()
+bool ChargeControl::Receive(uint32_t id, uint32_t data[2], uint8_t dlc)
+{
+   switch (id)
+   {
+   case 0x109: case 0x204: case 0x2B4: case 0x264: case 0x2A4: case 0x2C4:
+   case 0x3A4: case 0x424: case 0x504: case 0x76C:
+      rxRing.Push(id, data, dlc, Timebase::Millis(), Timebase::Micros());
+      return true;
+   default:
+      return false;
+   }
+}
+
+void ChargeControl::Run()
+{
+   ChargerStateMachine(PCSCan::CaptureInputs());
+
+   // Track PCS comms liveness for the VCU status bits. Age counters keep advancing
+   // even off-mode so they reflect true elapsed time once active again.
+   if (rx204Age < 0xFFFF) rx204Age++;
+   if (rx2B4Age < 0xFFFF) rx2B4Age++;
+
+   ms100Ticks++;
+}
+
+bool ChargeControl::IsCanEnabled()
+{
+   return CAN_Enable;
+}
+
+const TxSlot* ChargeControl::GetTxSlots()
+{
+   return txSlots;
+}
+
+int ChargeControl::GetTxSlotCount()
+{
+   return sizeof(txSlots) / sizeof(txSlots[0]);
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/stm32/dma.h>
+#include "dmaterminal.h"
+#include "hwdefs.h"
+
+DmaTerminal::DmaTerminal(uint32_t usart, const TERM_CMD* commands)
+   : Terminal(usart, commands), head(0), tail(0), inFlight(0), yielding(false), yield(0)
+{
+}
+
+void DmaTerminal::PutChar(char c)
+{
+   uint16_t next = (head + 1) % RING_SIZE;
+
+   while (next == tail)
+   {
+      Flush();
+
+      // Not re-entered, whatever the yield function prints simply waits here
+      if (yield != 0 && !yielding)
+      {
+         yielding = true;
+         yield();
+         yielding = false;
+      }
+   }
+
+   ring[head] = c;
+   head = next;
+
+   if (c == '\n') Flush();
+}
+
+void DmaTerminal::Flush()
+{
+   if (dma_get_number_of_data(DMA1, TERM_DMA_CHANNEL) != 0) return;
+
+   tail = (tail + inFlight) % RING_SIZE;
+   inFlight = 0;
+
+   if (head == tail) return;
+
+   // A transfer ends at the end of the ring, the wrapped part follows with the next one
+   inFlight = head > tail ? head - tail : RING_SIZE - tail;
+
+   dma_disable_channel(DMA1, TERM_DMA_CHANNEL);
+   dma_set_memory_address(DMA1, TERM_DMA_CHANNEL, (uint32_t)&ring[tail]);
+   dma_set_number_of_data(DMA1, TERM_DMA_CHANNEL, inFlight);
+   dma_enable_channel(DMA1, TERM_DMA_CHANNEL);
+}
@@ -19,6 +19,7 @@
 #include <libopencm3/cm3/common.h>
 #include <libopencm3/cm3/nvic.h>
 #include <libopencm3/cm3/scb.h>
+#include <libopencm3/cm3/systick.h>
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/usart.h>
@@ -117,7 +118,9 @@ void nvic_setup(void)
 
 /* Same level as the TIM2 scheduler: equal priority never preempts, so a Send()
  * from task context cannot interrupt HandleTx(), and RX handlers cannot
- * interrupt tasks. Call after the Stm32Can ctor, which sets its own. */
+ * interrupt tasks. Our own RX callback only queues frames for Ms10Task, but
+ * CanSdo still replies from within the RX interrupt, so RX must not be raised
+ * above the tasks. Call after the Stm32Can ctor, which sets its own. */
 void nvic_can_setup(void)
 {
    nvic_set_priority(NVIC_USB_HP_CAN_TX_IRQ,  0xe << 4);
@@ -125,6 +128,15 @@ void nvic_can_setup(void)
    nvic_set_priority(NVIC_CAN_RX1_IRQ,        0xe << 4);
 }
 
+/* 1kHz SysTick, drives the Timebase millisecond clock */
+void systick_setup(void)
+{
+   systick_set_clocksource(STK_CSR_CLKSOURCE_AHB);
+   systick_set_reload(72000000 / 1000 - 1);
+   systick_interrupt_enable();
+   systick_counter_enable();
+}
+
 void rtc_setup()
 {
    //Base clock is HSE/128 = 8MHz/128 = 62.5kHz
@@ -133,6 +145,32 @@ void rtc_setup()
    rtc_set_counter_val(0);
 }
 
+/*
+* Telemetry USART, transmit only. The DMA channel is configured here,
+* Telemetry::Send() only sets address and length of each transfer.
+*/
+void tlm_usart_setup(void)
+{
+   gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, GPIO_USART1_TX);
+
+   usart_set_baudrate(TLM_USART, TLM_BAUD);
+   usart_set_databits(TLM_USART, 8);
+   usart_set_stopbits(TLM_USART, USART_STOPBITS_1);
+   usart_set_mode(TLM_USART, USART_MODE_TX);
+   usart_set_parity(TLM_USART, USART_PARITY_NONE);
+   usart_set_flow_control(TLM_USART, USART_FLOWCONTROL_NONE);
+   usart_enable_tx_dma(TLM_USART);
+   usart_enable(TLM_USART);
+
+   dma_channel_reset(DMA1, TLM_DMA_CHANNEL);
+   dma_set_peripheral_address(DMA1, TLM_DMA_CHANNEL, (uint32_t)&USART_DR(TLM_USART));
+   dma_set_read_from_memory(DMA1, TLM_DMA_CHANNEL);
+   dma_enable_memory_increment_mode(DMA1, TLM_DMA_CHANNEL);
+   dma_set_peripheral_size(DMA1, TLM_DMA_CHANNEL, DMA_CCR_PSIZE_8BIT);
+   dma_set_memory_size(DMA1, TLM_DMA_CHANNEL, DMA_CCR_MSIZE_8BIT);
+   dma_set_priority(DMA1, TLM_DMA_CHANNEL, DMA_CCR_PL_LOW);
+}
+
 /*
 * Setup timer for measuring 1 Khz Pilot dutycycle
 */
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/systick.h>
+#include "idle.h"
+#include "profiler.h"
+
+#define CALIBRATION_PASSES 16
+
+uint32_t Idle::passCycles = 0;
+volatile uint32_t Idle::idleCycles = 0;
+uint32_t Idle::lastIdle = 0;
+
+void Idle::Calibrate(Pass pass)
+{
+   uint32_t best = 0xFFFFFFFF;
+
+   // The fastest pass is the one without work and without interruptions
+   cm_disable_interrupts();
+   for (int i = 0; i < CALIBRATION_PASSES; i++)
+   {
+      uint32_t start = Profiler::Start();
+      pass();
+      uint32_t cycles = Profiler::Start() - start;
+      best = cycles < best ? cycles : best;
+   }
+   cm_enable_interrupts();
+
+   passCycles = best;
+}
+
+void Idle::Run(Pass pass)
+{
+   if (pass()) return;
+
+   // SysTick runs on the core clock and wakes us every reload + 1 cycles, so a sleep
+   // never spans a full period and the difference of two readings is unambiguous.
+   uint32_t period = systick_get_reload() + 1;
+
+   cm_disable_interrupts();
+   uint32_t before = systick_get_value();
+   __asm__ volatile("wfi");
+   uint32_t after = systick_get_value();
+   cm_enable_interrupts();
+
+   idleCycles = idleCycles + passCycles + (before - after + period) % period;
+}
+
+s32fp Idle::Update()
+{
+   uint32_t idle = idleCycles - lastIdle;
+   uint32_t window = (systick_get_reload() + 1) * 100; // 100ms
+
+   lastIdle += idle;
+   if (idle > window) idle = window;
+
+   return FP_FROMINT(100) - FP_FROMINT(idle) / (window / 100);
+}
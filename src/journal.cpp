@@ -0,0 +1,254 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/desig.h>
+#include <libopencm3/stm32/memorymap.h>
+#include "hwdefs.h"
+#include "journal.h"
+#include "timebase.h"
+
+#define JOURNAL_MAGIC   0x4C4E524A // "JRNL"
+#define ERASED_WORD     0xFFFFFFFF
+
+struct PageHeader
+{
+   uint32_t magic;
+   uint32_t seq;     // increments with every page started, the highest one is being written
+};
+
+#define RECS_PER_PAGE   ((FLASH_PAGE_SIZE - sizeof(PageHeader)) / sizeof(Journal::Record))
+
+Journal::Record Journal::queue[QUEUE_SIZE];
+volatile uint8_t Journal::head = 0;
+volatile uint8_t Journal::tail = 0;
+uint32_t Journal::drops = 0;
+int Journal::curPage = 0;
+int Journal::writeSlot = 0;
+uint32_t Journal::curSeq = 0;
+uint16_t Journal::boot = 0;
+bool Journal::nextErased = false;
+
+static uint32_t PageAddr(int page)
+{
+   return FLASH_BASE + desig_get_flash_size() * 1024 - (JOURNAL_BLKNUM + page) * FLASH_PAGE_SIZE;
+}
+
+static const PageHeader* Header(int page)
+{
+   return (const PageHeader*)PageAddr(page);
+}
+
+static const Journal::Record* Slot(int page, int slot)
+{
+   return (const Journal::Record*)(PageAddr(page) + sizeof(PageHeader)) + slot;
+}
+
+static bool IsValid(int page)
+{
+   return Header(page)->magic == JOURNAL_MAGIC;
+}
+
+static bool IsErased(const void* addr, uint32_t bytes)
+{
+   const uint32_t* words = (const uint32_t*)addr;
+
+   for (uint32_t i = 0; i < bytes / 4; i++)
+      if (words[i] != ERASED_WORD) return false;
+   return true;
+}
+
+static int NextPage(int page)
+{
+   return (page + 1) % JOURNAL_NUMBLKS;
+}
+
+static void ErasePage(int page)
+{
+   flash_unlock();
+   flash_erase_page(PageAddr(page));
+   flash_lock();
+}
+
+void Journal::Init()
+{
+   int newest = -1;
+
+   for (int page = 0; page < JOURNAL_NUMBLKS; page++)
+   {
+      if (!IsValid(page)) continue;
+
+      if (newest < 0 || (int32_t)(Header(page)->seq - curSeq) > 0)
+      {
+         newest = page;
+         curSeq = Header(page)->seq;
+      }
+
+      for (uint32_t slot = 0; slot < RECS_PER_PAGE; slot++)
+      {
+         const Record* r = Slot(page, slot);
+         if (r->type != REC_EMPTY && r->boot >= boot) boot = r->boot + 1;
+      }
+   }
+
+   if (newest < 0)
+   {
+      // Blank or foreign content, start over at the first page
+      if (!IsErased(Header(0), FLASH_PAGE_SIZE)) ErasePage(0);
+      StartPage(0, 1);
+   }
+   else
+   {
+      curPage = newest;
+      writeSlot = RECS_PER_PAGE;
+
+      // Continue after the last programmed slot
+      while (writeSlot > 0 && IsErased(Slot(curPage, writeSlot - 1), sizeof(Record)))
+         writeSlot--;
+   }
+
+   // The scheduler is not running yet, so this is the one place an erase costs nothing
+   if (!IsErased(Header(NextPage(curPage)), FLASH_PAGE_SIZE))
+      ErasePage(NextPage(curPage));
+   nextErased = true;
+
+   Log(REC_BOOT, 0);
+   Run(false);
+}
+
+void Journal::Log(RecordType type, uint8_t value)
+{
+   uint32_t now = Timebase::Millis();
+   // The scheduler tasks and the main loop both log, so one of them may preempt
+   // the other between reading head and storing it. Claim and fill the slot masked.
+   bool masked = cm_mask_interrupts(true);
+   uint8_t h = head;
+
+   if (((h + 1) % QUEUE_SIZE) == tail)
+   {
+      drops++;
+   }
+   else
+   {
+      queue[h].type = type;
+      queue[h].value = value;
+      queue[h].boot = boot;
+      queue[h].time = now;
+      __atomic_store_n(&head, (h + 1) % QUEUE_SIZE, __ATOMIC_RELEASE);
+   }
+   cm_mask_interrupts(masked);
+}
+
+void Journal::Run(bool eraseAllowed)
+{
+   while (tail != __atomic_load_n(&head, __ATOMIC_ACQUIRE))
+   {
+      if (writeSlot >= (int)RECS_PER_PAGE)
+      {
+         if (!nextErased) break; // keep queueing until we may erase
+         StartPage(NextPage(curPage), curSeq + 1);
+      }
+
+      if (Program(queue[tail]))
+         __atomic_store_n(&tail, (tail + 1) % QUEUE_SIZE, __ATOMIC_RELEASE);
+   }
+
+   // At most one erase per call, it is the oldest page we are about to overwrite
+   if (!nextErased && eraseAllowed)
+   {
+      ErasePage(NextPage(curPage));
+      nextErased = true;
+   }
+}
+
+bool Journal::IsBlocked()
+{
+   return !nextErased && HasPending() && writeSlot >= (int)RECS_PER_PAGE;
+}
+
+const Journal::Record* Journal::First()
+{
+   // The oldest page is the first valid one after the current page
+   for (int i = 1; i <= JOURNAL_NUMBLKS; i++)
+   {
+      int page = (curPage + i) % JOURNAL_NUMBLKS;
+
+      if (IsValid(page)) return Next(Slot(page, 0) - 1); // start from the slot before the first
+   }
+   return 0;
+}
+
+const Journal::Record* Journal::Next(const Record* r)
+{
+   int page = 0;
+
+   while ((uint32_t)r < PageAddr(page) || (uint32_t)r >= PageAddr(page) + FLASH_PAGE_SIZE)
+      page++;
+
+   for (;;)
+   {
+      r++;
+
+      if (r >= Slot(page, RECS_PER_PAGE))
+      {
+         if (page == curPage) return 0;
+         page = NextPage(page);
+         r = Slot(page, 0);
+      }
+      if (page == curPage && r >= Slot(curPage, writeSlot)) return 0;
+      if (r->type != REC_EMPTY) return r;
+   }
+}
+
+void Journal::StartPage(int page, uint32_t seq)
+{
+   flash_unlock();
+   flash_program_word(PageAddr(page) + 4, seq);
+   flash_program_word(PageAddr(page), JOURNAL_MAGIC);
+   flash_lock();
+
+   curPage = page;
+   curSeq = seq;
+   writeSlot = 0;
+   nextErased = false;
+}
+
+bool Journal::Program(const Record& r)
+{
+   // Skip slots left half written by a power loss, they can not be programmed again
+   while (writeSlot < (int)RECS_PER_PAGE && !IsErased(Slot(curPage, writeSlot), sizeof(Record)))
+      writeSlot++;
+
+   if (writeSlot >= (int)RECS_PER_PAGE) return false;
+
+   uint32_t addr = (uint32_t)Slot(curPage, writeSlot);
+   const uint32_t* words = (const uint32_t*)&r;
+
+   // A word is programmed low half first, so go by half words to program
+   // the type last: a record with a type has its boot number and time
+   flash_unlock();
+   flash_program_word(addr + 4, words[1]);
+   flash_program_half_word(addr + 2, r.boot);
+   flash_program_half_word(addr, words[0] & 0xFFFF);
+   flash_lock();
+
+   writeSlot++;
+   return true;
+}
@@ -28,7 +28,7 @@
 #include "canmap.h"
 #include "cansdo.h"
 #include "sdocommands.h"
-#include "terminal.h"
+#include "dmaterminal.h"
 #include "params.h"
 #include "hwdefs.h"
 #include "digio.h"
@@ -41,237 +41,172 @@
 #include "stm32scheduler.h"
 #include "terminalcommands.h"
 #include "PCSCan.h"
+#include "timebase.h"
+#include "canfilter.h"
+#include "pcsshadow.h"
+#include "pcsalerts.h"
+#include "journal.h"
+#include "txsched.h"
+#include "busstats.h"
+#include "latency.h"
+#include "profiler.h"
+#include "workqueue.h"
+#include "idle.h"
+#include "telemetry.h"
+#include "sdobulk.h"
+#include "changelog.h"
+#include "chargecontrol.h"
 
 #define PRINT_JSON 0
 
+// Userspace SDO objects, read only. SdoBulk::INDEX_VALUES is served by SdoBulk,
+// its SdoBulk::INDEX_RANGE and SdoBulk::INDEX_SINCE are the writable objects.
+#define SDO_INDEX_ALERT_TIME  0x4100 // sub 0: events logged, sub n: time of the n-th newest alert event in ms
+#define SDO_INDEX_ALERT_EVENT 0x4101 // sub 0: events logged, sub n: alert id, bit 8 set on onset
+#define SDO_INDEX_PROFILE     0x4110 // 0x4110 + Profiler::Stat, sub n: probe n, in CPU cycles
+
 extern "C" void __cxa_pure_virtual() { while (1); }
 
 static Stm32Scheduler *scheduler;
 static CanHardware* can;
 static CanMap* canMap;
 static CanSdo* canSdo;
-static Terminal* terminal;
-
-static uint32_t startTime;
-static bool CAN_Enable = false;
-static uint16_t ChgPower = 0;
-static bool ZeroPower = false;
-
-// Charge power request ramp (0x2B2), stepped once per Ms100Task cycle (100ms).
-// DO NOT EVER TOUCH THE RAMP TIME!!!! CHARGER WILL NOT ACCEPT ANY FASTER!!!
-#define CHG_PWR_RAMP_UP 10 // W per 100ms ramping towards a higher setpoint (100W/s)
-#define CHG_PWR_RAMP_DN 10 // W per 100ms easing towards a lower setpoint (100W/s)
-
-// VCU status-bit (0x108) fault detection: debounce counters, ticked once per Ms100Task cycle (100ms).
-#define PCS_MIA_TIMEOUT_TICKS 10  // 1.0s without a 0x204/0x2B4 frame -> PCS presumed unreachable
-#define DCDC_FAULT_TICKS      30  // 3.0s of zero DC-DC output current while DC-DC is commanded on
-#define CHG_FAULT_TICKS       150 // 15s of zero charger output current while charging is commanded
-static uint16_t rx204Age = 0;            // ticks since last 0x204 (PCS charge status) frame
-static uint16_t rx2B4Age = 0;            // ticks since last 0x2B4 (PCS DC-DC status) frame
-static uint16_t dcdcZeroCurrentTicks = 0;
-static uint16_t chgZeroCurrentTicks = 0;
-
-void handle109(uint32_t data[2])
-{
-   uint8_t* bytes = (uint8_t*)data;//Mux id in byte 0.
+static DmaTerminal* terminal;
 
-   static bool vcuEn = false;
+// Soft work of Ms100Task, run from the main loop in this order of priority
+enum { JOB_DEBOUNCE, JOB_VCUSTATUS, JOB_TELEMETRY, JOB_STATUS, JOB_JOURNAL };
 
-   Param::SetInt(Param::opmode, bytes[0]); // opmode from VCU
+// Frames the charge control depends on get FIFO0, so bursts of logging
+// traffic can only ever overrun FIFO1.
+static const uint16_t controlIds[] = { 0x204, 0x2B4, 0x264, 0x109 };
+static const uint16_t loggingIds[] = { 0x2A4, 0x2C4, 0x3A4, 0x424, 0x504, 0x76C };
+static volatile uint32_t fifoFull[2];   // written by CanCallback
+static uint8_t fifoPending[2];          // frames each FIFO held at the last CanCallback
 
-   uint16_t vcuHVvolts=(bytes[2]<<8 |bytes[1]); //hv voltage from vcu
+// Userspace SDO requests, from reception to the reply
+static volatile uint32_t sdoRxMicros;   // written by CanCallback
+static LatencyStat sdoLatency(Param::sdolatmin);
 
-   Param::SetInt(Param::udcspnt, (bytes[4]<<8 | bytes[3])); // HV voltage setpoint from vcu
-   Param::SetInt(Param::pacspnt, (bytes[6]<<8 | bytes[5])); // max charger power from vcu
-   
-   // Set iaclim from (bits 56–59, encoded as 0–15 for 1–16A)
-   uint8_t currentLimit = bytes[7] & 0xF; // Extract 4-bit CurrentLimit
-   Param::SetInt(Param::iaclim, currentLimit + 1); // Map 0–15 to 1–16A
+// Aux voltage divider: ADC digits per volt x1000, applied in integer math
+#define UAUX_GAIN_MILLI 223418
 
-   if((bytes[7]>>4)==0xA) Param::SetInt(Param::chargerEnable, 1); // enable/disable request from vcu
-   if((bytes[7]>>4)==0xC) Param::SetInt(Param::chargerEnable, 0);
+// FIFO our filters route an ID to, -1 for the banks of libopeninv
+static int FifoOf(uint32_t id)
+{
+   for (unsigned i = 0; i < sizeof(controlIds) / sizeof(controlIds[0]); i++)
+      if (id == controlIds[i]) return 0;
+   for (unsigned i = 0; i < sizeof(loggingIds) / sizeof(loggingIds[0]); i++)
+      if (id == loggingIds[i]) return 1;
+   return -1;
 }
 
-
-static void ChargerStateMachine()
+/* The overrun flags cannot be counted: libopeninv's RX interrupt releases every frame
+ * with a read-modify-write of CAN_RFxR before it calls us, which writes the rc_w1 FOVRx
+ * bit back and clears it. What CanCallback does see is the number of frames still
+ * pending. An overrun needs a full FIFO and the interrupt that follows it finds all
+ * three mailboxes taken, so the times a FIFO was found full bound the overruns. */
+static void CountFifoFull(uint32_t id)
 {
-   uint8_t opmode = Param::GetInt(Param::opmode);
-
-   switch (opmode)
-   {
-   case MOD_OFF:
-      ZeroPower = true; // charger power =0 in off.
-      CAN_Enable = false;
-
-      DigIo::pcsena_out.Clear();    // pcs off
-      DigIo::dcdcena_out.Set();     // DC-DC off   
-      DigIo::chena_out.Set();       // PCS off
-      Param::SetInt(Param::activate, EN_NONE);
-      break;
+   uint8_t pending[2] = { (uint8_t)(CAN_RF0R(CAN1) & CAN_RF0R_FMP0_MASK),
+                          (uint8_t)(CAN_RF1R(CAN1) & CAN_RF1R_FMP1_MASK) };
+   int fifo = FifoOf(id);
 
-   case MOD_PRECHARGE:
-      break;
-
-   case MOD_RUN:
-      ZeroPower = true; // charger power=0 in drive.
-      CAN_Enable = true;
-
-      DigIo::pcsena_out.Set();      // pcs on
-      DigIo::chena_out.Set();       // charger off
-      DigIo::dcdcena_out.Clear();   // DC-DC on   
-      Param::SetInt(Param::activate, EN_DCDC);   
-      break;
+   if (fifo >= 0) pending[fifo]++; // this frame was released just before the callback
 
-   case MOD_CHARGE:
-      startTime = rtc_get_counter_val();
-      ZeroPower = false;
-      CAN_Enable = true;
-
-      if (!ZeroPower)  DigIo::chena_out.Clear(); // charger on
-      DigIo::pcsena_out.Set(); // pcs on
-      DigIo::dcdcena_out.Clear();   // DC-DC on
-      Param::SetInt(Param::activate, EN_BOTH);
-      break;
-   
-   case MOD_REQUEST_OFF:
-      // Graceful pre-OFF: command the PCS to wind down charger + DC-DC over CAN and
-      // hold here until the VCU opens the contactors / commands MOD_OFF. The PCS
-      // obeys the CAN content, so the enable pins must AGREE with 0x22A / 0x2B2.
-      ZeroPower = true;                        // 0x2B2 charge-power request -> 0
-      CAN_Enable = true;                       // keep the bus fed (no MIA, hears the shutdown)
-      Param::SetInt(Param::activate, EN_NONE); // 0x22A: shut down charger AND DC-DC
-
-      DigIo::pcsena_out.Set();    // keep PCS powered
-      DigIo::dcdcena_out.Set();   // DC-DC disable
-      DigIo::chena_out.Set();     // charger disable
-      break;
-   
-   default:
-      break;
+   for (int i = 0; i < 2; i++)
+   {
+      if (pending[i] >= 3 && fifoPending[i] < 3) fifoFull[i]++;
+      fifoPending[i] = pending[i];
    }
 }
 
-uint16_t ChgPwrRamp()
+static void Ms10Task(void)
 {
-   uint8_t Charger_state = Param::GetInt(Param::CHG_STAT);
-   uint16_t Charger_Pwr_Max = Param::GetInt(Param::pacspnt);
+   uint32_t start = Profiler::Start();
 
-   if (Charger_state != chargerStates::ENABLE)
-      ChgPower = 0; // Set power 0 immediately
+   static int tlmTicks = 0;
 
-   if (ZeroPower)
-      ChgPower = 0;
-   else if (ChgPower < Charger_Pwr_Max) // ramp up, clamped so we land exactly on the setpoint
-      ChgPower = (Charger_Pwr_Max - ChgPower > CHG_PWR_RAMP_UP) ? ChgPower + CHG_PWR_RAMP_UP : Charger_Pwr_Max;
-   else if (ChgPower > Charger_Pwr_Max) // ease down, clamped so we land exactly on the setpoint
-      ChgPower = (ChgPower - Charger_Pwr_Max > CHG_PWR_RAMP_DN) ? ChgPower - CHG_PWR_RAMP_DN : Charger_Pwr_Max;
+   ChargeControl::DecodeRxFrames();
+   Param::SetInt(Param::canfull0, fifoFull[0]);
+   Param::SetInt(Param::canfull1, fifoFull[1]);
+   Param::SetInt(Param::cantxhw, TxScheduler::GetQueueHighWater());
 
-   return ChgPower;
+   // Sampled here for exact timing, encoded and sent by the main loop
+   int tlmRate = Param::GetInt(Param::tlmrate) / 10;
+   if (tlmRate > 0 && ++tlmTicks >= tlmRate)
+   {
+      tlmTicks = 0;
+      Telemetry::Sample(Timebase::Millis());
+      WorkQueue::Post(JOB_TELEMETRY);
+   }
+   Profiler::Stop(Profiler::PRB_ms10, start);
 }
 
-static void Ms10Task(void)
+// Sends the periodic frames that are due in this slot
+static void TxSlotTask(void)
 {
-   if (!CAN_Enable) return;
+   uint32_t start = Profiler::Start();
 
-   // Send 10ms PCS CAN when enabled.
-   PCSCan::Msg13D();
-   PCSCan::Msg22A();
-   PCSCan::Msg3B2();
+   TxScheduler::Run(ChargeControl::IsCanEnabled(), Param::GetInt(Param::txmingap));
+   Profiler::Stop(Profiler::PRB_txslot, start);
 }
 
-static void Ms50Task(void)
+// Deferred from Ms100Task: values that are only displayed
+static void PublishStatus()
 {
-   if (CAN_Enable)
+   uint32_t tickMax = 0;
+
+   // Set timestamp of error message
+   ErrorMessage::SetTime(rtc_get_counter_val());
+   Param::SetInt(Param::uptime, rtc_get_counter_val());
+   Param::SetFixed(Param::uaux, FP_FROMINT(AnaIn::uaux.Get()) * 1000 / UAUX_GAIN_MILLI);
+   Param::SetInt(Param::jrnldrop, Journal::GetDrops());
+   Param::SetInt(Param::wqoverrun, WorkQueue::GetOverruns());
+   Param::SetInt(Param::tlmdrop, Telemetry::GetDrops());
+
+   // Longest the scheduler interrupt was busy with one task
+   for (int p = Profiler::PRB_ms10; p <= Profiler::PRB_txslot; p++)
    {
-      // Send 50ms PCS CAN when enabled.
-      PCSCan::Msg545();
-      // PCSCan::Msg221(); // VCFRONT emulation, disabled while chasing a charge fault
+      uint32_t cycles = Profiler::Get(p, Profiler::STAT_MAX);
+      tickMax = cycles > tickMax ? cycles : tickMax;
    }
+   Param::SetInt(Param::tickmax, tickMax / Profiler::CYCLES_PER_US);
 }
 
-// sample 100ms task
+// Posted by Ms100Task when the journal waits for a page while charging. The erase stalls
+// the core for ~20ms, right after the 100ms tick it delays the fewest tasks. One per tick.
+static void EraseJournalPage()
+{
+   if (Journal::IsBlocked()) Journal::Run(true);
+}
+
+// Indexed by JOB_*
+static const WorkFunction workJobs[] =
+{
+   ChargeControl::DebounceFaults, ChargeControl::PackVcuStatus, Telemetry::Send, PublishStatus,
+   EraseJournalPage
+};
+
+// sample 100ms task, only the time-critical part. The rest is posted to the main loop.
 static void Ms100Task(void)
 {
+   uint32_t start = Profiler::Start();
+
    DigIo::led_out.Toggle();
    // The boot loader enables the watchdog, we have to reset it
    // at least every 2s or otherwise the controller is hard reset.
    iwdg_reset();
-   // Calculate CPU load. Don't be surprised if it is zero.
-   float cpuLoad = scheduler->GetCpuLoad() / 10.0f;
    // This sets a fixed point value WITHOUT calling the parm_Change() function
-   Param::SetFloat(Param::cpuload, cpuLoad);
-   // Set timestamp of error message
-   ErrorMessage::SetTime(rtc_get_counter_val());
-   Param::SetInt(Param::uptime, rtc_get_counter_val());
-   Param::SetFloat(Param::uaux, AnaIn::uaux.Get() / 223.418f);
-
-   ChargerStateMachine();
-   PCSCan::AlertHandler();
-
-   // Track PCS comms liveness and sustained zero-output conditions for the VCU status bits below.
-   // Age counters keep advancing even off-mode so they reflect true elapsed time once active again.
-   if (rx204Age < 0xFFFF) rx204Age++;
-   if (rx2B4Age < 0xFFFF) rx2B4Age++;
-
-   bool dcdcCommanded = (Param::GetInt(Param::activate) & EN_DCDC) != 0;
-   if (dcdcCommanded && Param::GetFloat(Param::idcdc) <= 0.0f)
-      dcdcZeroCurrentTicks = (dcdcZeroCurrentTicks < 0xFFFF) ? dcdcZeroCurrentTicks + 1 : dcdcZeroCurrentTicks;
-   else
-      dcdcZeroCurrentTicks = 0;
-
-   bool chgCommanded = Param::GetInt(Param::opmode) == MOD_CHARGE
-                     && Param::GetInt(Param::chargerEnable)
-                     && Param::GetInt(Param::pacspnt) > 0;
-   if (chgCommanded && Param::GetFloat(Param::idc) <= 0.0f)
-      chgZeroCurrentTicks = (chgZeroCurrentTicks < 0xFFFF) ? chgZeroCurrentTicks + 1 : chgZeroCurrentTicks;
-   else
-      chgZeroCurrentTicks = 0;
+   Param::SetFixed(Param::cpuload, Idle::Update());
+   BusStats::Update();
 
-   if (CAN_Enable)
-   {
-      // Send 100ms PCS CAN when enabled.
-      PCSCan::Msg20A();
-      PCSCan::Msg212();
-      PCSCan::Msg21D();
-      PCSCan::Msg232();
-      PCSCan::Msg23D();
-      PCSCan::Msg25D();
-      PCSCan::Msg2B2(ChgPwrRamp());
-      PCSCan::Msg321();
-      PCSCan::Msg333();
-      PCSCan::Msg3A1();
-      // PCSCan::Msg2D1(); // VCFRONT emulation, disabled while chasing a charge fault
-   }
+   ChargeControl::Run();
+   WorkQueue::Post(JOB_DEBOUNCE);
+   WorkQueue::Post(JOB_VCUSTATUS);
+   WorkQueue::Post(JOB_STATUS);
+   if (Journal::IsBlocked()) WorkQueue::Post(JOB_JOURNAL);
 
-   // Status msg to VCU
-   if (Param::GetInt(Param::opmode) != MOD_OFF)
-   {
-      uint8_t bytes[3];
-
-      // Pack GridCFG (2 bits) and uac (10 bits) into bytes[0] and bytes[1]
-      uint16_t uac = Param::GetInt(Param::uac);
-      uint8_t gridcfg = Param::GetInt(Param::GridCFG) & 0x03;
-
-      // Charger/DC-DC fault: PCS unreachable (no 0x204/0x2B4 for >1s), PCS reports FAULTED (charger
-      // only), or sustained zero output current while that subsystem is actually commanded on.
-      // "Other alert" is a low-detail catch-all for anything not covered by the two bits above.
-      bool chgFault = (rx204Age > PCS_MIA_TIMEOUT_TICKS)
-                    || (Param::GetInt(Param::CHG_STAT) == chargerStates::FAULTED)
-                    || (chgZeroCurrentTicks > CHG_FAULT_TICKS);
-      bool dcdcFault = (rx2B4Age > PCS_MIA_TIMEOUT_TICKS)
-                     || (dcdcZeroCurrentTicks > DCDC_FAULT_TICKS);
-      bool otherAlert = Param::GetInt(Param::PCSAlertCnt) > 0;
-
-      bytes[0] = (uint8_t)(uac & 0xFF);                    // AC voltage bits 0-7
-      bytes[1] = (uint8_t)((uac >> 8) & 0x03)              // AC voltage bits 8-9 (in byte[1] bits 0-1)
-              | (gridcfg << 2)                              // GridCFG bits 0-1 (in byte[1] bits 2-3)
-              | (chgFault << 4)                             // Charger_Fault (byte[1] bit 4)
-              | (dcdcFault << 5)                            // DCDC_Fault (byte[1] bit 5)
-              | (otherAlert << 6);                          // PCS_Other_Alert (byte[1] bit 6)
-      bytes[2] = (uint8_t)(Param::GetFloat(Param::CHGPAvail) * 10.0f);
-      Stm32Can::GetInterface(0)->Send(0x108, (uint32_t *)bytes, 3);
-   }
-   
+   Profiler::Stop(Profiler::PRB_ms100, start);
 }
 
 
@@ -279,17 +214,12 @@ static void Ms100Task(void)
 //CAN interface of a device, this will be called by the CanHardware module
 static void SetCanFilters()
 {
-   // Set up CAN  callback and messages to listen for
-   can->RegisterUserMessage(0x204); // PCS Charge Status
-   can->RegisterUserMessage(0x2B4); // PCS DCDC Status
-   can->RegisterUserMessage(0x264); // PCS Chg Line Status
-   can->RegisterUserMessage(0x2A4); // PCS Temps
-   can->RegisterUserMessage(0x2C4); // PCS Logging
-   can->RegisterUserMessage(0x3A4); // PCS Alert Matrix
-   can->RegisterUserMessage(0x424); // PCS Alert Log
-   can->RegisterUserMessage(0x504); // PCS Boot ID
-   can->RegisterUserMessage(0x76C); // PCS Debug output
-   can->RegisterUserMessage(0x109); // VCU charge request
+   // The PCS and VCU frames bypass RegisterUserMessage(), which spreads its IDs over
+   // both FIFOs by bank number. We program our own banks from the top instead,
+   // CanHardware still hands every accepted frame to CanCallback.
+   int bank = CanFilter::TOP_BANK;
+   bank = CanFilter::Apply(controlIds, sizeof(controlIds) / sizeof(controlIds[0]), 0, bank); // PCS status, DCDC status, line status, VCU request
+   bank = CanFilter::Apply(loggingIds, sizeof(loggingIds) / sizeof(loggingIds[0]), 1, bank); // Temps, logging, alerts, boot ID, debug
 }
 
 /** This function is called when the user changes a parameter */
@@ -309,24 +239,147 @@ void Param::Change(Param::PARAM_NUM paramNum)
 
 static bool CanCallback(uint32_t id, uint32_t data[2], uint8_t dlc) // Called when a defined CAN message is received.
 {
-   dlc = dlc;
-   switch (id)
+   // Interrupt context: only timestamp and queue, decoding happens in Ms10Task
+   uint32_t start = Profiler::Start();
+
+   CountFifoFull(id);
+   BusStats::CountRx(id, dlc);
+   if (id == 0x600U + Param::GetInt(Param::nodeid))
    {
-   case 0x204: PCSCan::handle204(data); rx204Age = 0; break; // PCS Charge status
-   case 0x2B4: PCSCan::handle2B4(data); rx2B4Age = 0; break; // DCDC info
-   case 0x264: PCSCan::handle264(data); break; // PCS Charge Line Status
-   case 0x2A4: PCSCan::handle2A4(data); break; // PCS Temps
-   case 0x2C4: PCSCan::handle2C4(data); break; // PCS Logging
-   case 0x3A4: PCSCan::handle3A4(data); break; // PCS Alert Matrix
-   case 0x424: PCSCan::handle424(data); break; // PCS Alert Log
-   case 0x504: PCSCan::handle504(data); break; // PCS Boot ID
-   case 0x76C: PCSCan::handle76C(data); break; // PCS Debug output
-   case 0x109: handle109(data);         break; // VCU charge request and power limits
-   default: break;
+      sdoRxMicros = Timebase::Micros();
+      // Bulk transfers are ours alone, returning true keeps them from CanSdo
+      if (SdoBulk::HandleRx(data))
+      {
+         Profiler::Stop(Profiler::PRB_canrx, start);
+         return true;
+      }
    }
+
+   ChargeControl::Receive(id, data, dlc);
+   Profiler::Stop(Profiler::PRB_canrx, start);
    return false;
 }
 
+// Serves our own SDO objects, returns false for everything else
+static bool ProcessUserSdo(CanSdo::SdoFrame* sdo)
+{
+   bool profile = sdo->index >= SDO_INDEX_PROFILE && sdo->index < SDO_INDEX_PROFILE + Profiler::STAT_LAST;
+
+   if (sdo->index == SdoBulk::INDEX_RANGE || sdo->index == SdoBulk::INDEX_SINCE)
+   {
+      bool range = sdo->index == SdoBulk::INDEX_RANGE;
+
+      if (sdo->cmd == SDO_READ)
+      {
+         sdo->cmd = SDO_READ_REPLY;
+         sdo->data = range ? SdoBulk::GetRange() : ChangeLog::Scan();
+      }
+      else if (sdo->cmd == SDO_WRITE)
+      {
+         if (range)
+            SdoBulk::SetRange(sdo->data);
+         else
+            SdoBulk::SetSince(sdo->data);
+         sdo->cmd = SDO_WRITE_REPLY;
+      }
+      else
+      {
+         sdo->cmd = SDO_ABORT;
+         sdo->data = SDO_ERR_INVIDX;
+      }
+      return true;
+   }
+
+   if (sdo->index != SDO_INDEX_ALERT_TIME && sdo->index != SDO_INDEX_ALERT_EVENT && !profile)
+      return false;
+
+   if (sdo->cmd != SDO_READ)
+   {
+      sdo->cmd = SDO_ABORT;
+      sdo->data = SDO_ERR_INVIDX;
+      return true;
+   }
+
+   AlertEvent e;
+
+   if (profile)
+   {
+      if (sdo->subIndex < Profiler::PRB_LAST)
+      {
+         sdo->cmd = SDO_READ_REPLY;
+         sdo->data = Profiler::Get(sdo->subIndex, (Profiler::Stat)(sdo->index - SDO_INDEX_PROFILE));
+      }
+      else
+      {
+         sdo->cmd = SDO_ABORT;
+         sdo->data = SDO_ERR_RANGE;
+      }
+   }
+   else if (sdo->subIndex == 0)
+   {
+      sdo->cmd = SDO_READ_REPLY;
+      sdo->data = PcsAlerts::GetEventCount();
+   }
+   else if (PcsAlerts::GetEvent(sdo->subIndex - 1, e))
+   {
+      sdo->cmd = SDO_READ_REPLY;
+      sdo->data = sdo->index == SDO_INDEX_ALERT_TIME ? e.time : e.id | (e.onset << 8);
+   }
+   else
+   {
+      sdo->cmd = SDO_ABORT;
+      sdo->data = SDO_ERR_RANGE;
+   }
+   return true;
+}
+
+// Answers a pending userspace SDO request, returns false if there was none
+static bool ServeSdo()
+{
+   CanSdo::SdoFrame* sdoFrame = canSdo->GetPendingUserspaceSdo();
+
+   if (0 == sdoFrame) return false;
+
+   CanSdo::SdoFrame sdoOrig = *sdoFrame;
+   if (!ProcessUserSdo(sdoFrame))
+      SdoCommands::ProcessStandardCommands(sdoFrame);
+
+   canSdo->SendSdoReply(sdoFrame);
+   sdoLatency.Add(Timebase::Micros() - sdoRxMicros);
+   return true;
+}
+
+// Runs while terminal output waits for the UART
+static void ServeDuringOutput()
+{
+   ServeSdo();
+   SdoBulk::Run();
+   WorkQueue::Run();
+}
+
+// One round of the background work, returns true if there was any.
+// This is also what Idle calibrates as the cost of an empty pass.
+static bool MainLoopPass()
+{
+   char c = 0;
+   bool busy = false;
+   terminal->Run();
+   terminal->Flush();
+   busy |= WorkQueue::Run();
+   busy |= Journal::HasPending();
+   // Page erases stall the CPU, only allow them here while the PCS is off, see EraseJournalPage
+   Journal::Run(Param::GetInt(Param::opmode) == MOD_OFF);
+
+   if (canSdo->GetPrintRequest() == PRINT_JSON)
+   {
+      TerminalCommands::PrintParamsJson(canSdo, &c);
+      busy = true;
+   }
+   busy |= ServeSdo();
+   busy |= SdoBulk::Run();
+   return busy;
+}
+
 // Whichever timer(s) you use for the scheduler, you have to
 // implement their ISRs here and call into the respective scheduler
 extern "C" void tim2_isr(void)
@@ -334,12 +387,18 @@ extern "C" void tim2_isr(void)
    scheduler->Run();
 }
 
+extern "C" void sys_tick_handler(void)
+{
+   Timebase::Tick();
+}
+
 extern "C" int main(void)
 {
    extern const TERM_CMD termCmds[];
 
    clock_setup(); // Must always come first
    rtc_setup();
+   systick_setup();
    ANA_IN_CONFIGURE(ANA_IN_LIST);
    DIG_IO_CONFIGURE(DIG_IO_LIST);
    AnaIn::Start();             // Starts background ADC conversion via DMA
@@ -347,8 +406,13 @@ extern "C" int main(void)
    gpio_primary_remap(AFIO_MAPR_SWJ_CFG_JTAG_OFF_SW_ON, AFIO_MAPR_CAN1_REMAP_PORTB);
 
    tim_setup();                  // Use timer3 for sampling pilot PWM
+   tlm_usart_setup();            // Binary telemetry on USART1
    nvic_setup();                 // Set up some interrupts
    parm_load();                  // Load stored parameters
+   BusStats::Init();             // Before CAN delivers the first frame
+   Telemetry::Init();
+   Journal::Init();              // May erase a flash page, must run before the scheduler
+   ChangeLog::Init(Journal::GetBoot());
 
    //store a pointer for easier access
    FunctionPointerCallback canCb(CanCallback, SetCanFilters);
@@ -368,11 +432,21 @@ extern "C" int main(void)
    canSdo->SetNodeId(Param::GetInt(Param::nodeid)); //Set node ID for SDO access e.g. by wifi module
    SdoCommands::SetCanMap(canMap);
 
+   TxScheduler::Init(ChargeControl::GetTxSlots(), ChargeControl::GetTxSlotCount());
+   WorkQueue::Init(workJobs, sizeof(workJobs) / sizeof(workJobs[0]));
+   Profiler::Init();
+   Profiler::SetPeriod(Profiler::PRB_ms10, 10000);
+   Profiler::SetPeriod(Profiler::PRB_ms100, 100000);
+   Profiler::SetPeriod(Profiler::PRB_txslot, TxScheduler::SLOT_MS * 1000);
+
    Stm32Scheduler s(TIM2); // We never exit main so it's ok to put it on stack
    scheduler = &s;
 
-   Terminal t(USART3, termCmds);
+   DmaTerminal t(USART3, termCmds);
    terminal = &t;
+   t.SetYield(ServeDuringOutput);
+
+   Idle::Calibrate(MainLoopPass);
 
    // Up to four tasks can be added to each timer scheduler
    // AddTask takes a function pointer and a calling interval in milliseconds.
@@ -380,8 +454,8 @@ extern "C" int main(void)
    // You have to enable the interrupt (int this case for TIM2) in nvic_setup()
    // There you can also configure the priority of the scheduler over other interrupts
    s.AddTask(Ms100Task, 100);
-   s.AddTask(Ms50Task, 50);
    s.AddTask(Ms10Task, 10);
+   s.AddTask(TxSlotTask, TxScheduler::SLOT_MS);
 
    // backward compatibility, version 4 was the first to support the "stream" command
    Param::SetInt(Param::version, 4);
@@ -389,24 +463,10 @@ extern "C" int main(void)
    // Now all our main() does is running the terminal
    // All other processing takes place in the scheduler or other interrupt service routines
    // The terminal has lowest priority, so even loading it down heavily will not disturb
-   // our more important processing routines.
+   // our more important processing routines. Passes without work sleep until the next interrupt.
    while(1)
    {
-      char c = 0;
-      CanSdo::SdoFrame* sdoFrame = sdo.GetPendingUserspaceSdo();
-      terminal->Run();
-
-      if (canSdo->GetPrintRequest() == PRINT_JSON)
-      {
-         TerminalCommands::PrintParamsJson(canSdo, &c);
-      }
-      if (0 != sdoFrame)
-      {
-         CanSdo::SdoFrame sdoOrig = *sdoFrame;
-         SdoCommands::ProcessStandardCommands(sdoFrame);
-
-         sdo.SendSdoReply(sdoFrame);
-      }
+      Idle::Run(MainLoopPass);
    }
 
    return 0;
@@ -0,0 +1,119 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pcsalerts.h"
+#include "pcsshadow.h"
+#include "journal.h"
+
+#define ALERTS_PER_PAGE 60
+#define ALERTS_PER_GROUP 26 // s32fp flag fields can hold 26 usable bits
+
+uint64_t PcsAlerts::active[2];
+AlertEvent PcsAlerts::events[LOG_SIZE];
+volatile uint32_t PcsAlerts::eventCount = 0;
+
+// Returns len (< 64) bits of the 128-bit set starting at bit start
+static uint64_t ExtractBits(const uint64_t set[2], int start, int len)
+{
+   uint64_t bits = start >= 64 ? set[1] >> (start - 64)
+                 : start == 0 ? set[0]
+                 : (set[0] >> start) | (set[1] << (64 - start));
+   return bits & ((1ull << len) - 1);
+}
+
+void PcsAlerts::UpdatePage(uint8_t page, const uint32_t data[2], uint32_t time)
+{
+   // Each page carries 60 alerts in payload bits 4..63: page 0 -> alerts 1..60, page 1 -> alerts 61..120.
+   int first = page * ALERTS_PER_PAGE;
+
+   if (first >= NUM_ALERTS) return;
+
+   int count = NUM_ALERTS - first < ALERTS_PER_PAGE ? NUM_ALERTS - first : ALERTS_PER_PAGE;
+   uint64_t mask = (1ull << count) - 1;
+   uint64_t bits = ((((uint64_t)data[1] << 32) | data[0]) >> 4) & mask;
+
+   // Place page bits and mask at their offset in the 128-bit set
+   uint64_t newBits[2], placeMask[2];
+   newBits[0] = first < 64 ? bits << first : 0;
+   placeMask[0] = first < 64 ? mask << first : 0;
+   newBits[1] = first == 0 ? 0 : first < 64 ? bits >> (64 - first) : bits << (first - 64);
+   placeMask[1] = first == 0 ? 0 : first < 64 ? mask >> (64 - first) : mask << (first - 64);
+
+   bool changed = false;
+
+   for (int w = 0; w < 2; w++)
+   {
+      uint64_t updated = (active[w] & ~placeMask[w]) | newBits[w];
+      uint64_t diff = active[w] ^ updated;
+
+      active[w] = updated;
+      changed |= diff != 0;
+
+      while (diff)
+      {
+         int bit = __builtin_ctzll(diff);
+         diff &= diff - 1;
+         LogEvent(w * 64 + bit + 1, (updated >> bit) & 1, time);
+      }
+   }
+
+   if (changed) PublishGroups();
+}
+
+bool PcsAlerts::IsActive(uint8_t id)
+{
+   if (id < 1 || id > NUM_ALERTS) return false;
+   return (active[(id - 1) / 64] >> ((id - 1) % 64)) & 1;
+}
+
+bool PcsAlerts::GetEvent(uint32_t age, AlertEvent& e)
+{
+   uint32_t count;
+
+   // The log is written from the scheduler, retry if it added an event while we copied
+   do
+   {
+      count = eventCount;
+      if (age >= count || age >= LOG_SIZE) return false;
+      e = events[(count - 1 - age) % LOG_SIZE];
+   } while (count != eventCount);
+
+   return true;
+}
+
+void PcsAlerts::LogEvent(uint8_t id, bool onset, uint32_t time)
+{
+   AlertEvent& e = events[eventCount % LOG_SIZE];
+   e.time = time;
+   e.id = id;
+   e.onset = onset;
+   eventCount = eventCount + 1;
+
+   Journal::Log(onset ? Journal::REC_ALERT_ON : Journal::REC_ALERT_OFF, id);
+}
+
+void PcsAlerts::PublishGroups()
+{
+   // Flag value for alert N in group G is 1 << ((N-1) % 26); the web UI renders each group combined as "a | b | c".
+   PcsShadow::SetInt(PcsShadow::PCSAlerts1, ExtractBits(active, 0, ALERTS_PER_GROUP));                    // alerts 1-26
+   PcsShadow::SetInt(PcsShadow::PCSAlerts2, ExtractBits(active, ALERTS_PER_GROUP, ALERTS_PER_GROUP));     // alerts 27-52
+   PcsShadow::SetInt(PcsShadow::PCSAlerts3, ExtractBits(active, 2 * ALERTS_PER_GROUP, ALERTS_PER_GROUP)); // alerts 53-78
+   PcsShadow::SetInt(PcsShadow::PCSAlerts4, ExtractBits(active, 3 * ALERTS_PER_GROUP, ALERTS_PER_GROUP)); // alerts 79-102
+   PcsShadow::SetInt(PcsShadow::PCSAlertCnt, __builtin_popcountll(active[0]) + __builtin_popcountll(active[1]));
+}
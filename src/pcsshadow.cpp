@@ -0,0 +1,62 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pcsshadow.h"
+#include "timebase.h"
+
+static_assert(PcsShadow::NUM_FIELDS <= 32, "dirty mask holds 32 fields");
+
+#define SHADOW_ENTRY(name) Param::name,
+static const Param::PARAM_NUM paramNums[PcsShadow::NUM_FIELDS] = { PCS_SHADOW_LIST };
+#undef SHADOW_ENTRY
+
+s32fp PcsShadow::values[NUM_FIELDS];
+uint32_t PcsShadow::dirty = 0;
+uint32_t PcsShadow::writes = 0;
+uint32_t PcsShadow::avoided = 0;
+uint32_t PcsShadow::windowStart = 0;
+
+void PcsShadow::Publish()
+{
+   uint32_t pending = dirty;
+   int published = 0;
+
+   dirty = 0;
+
+   while (pending)
+   {
+      int f = __builtin_ctz(pending);
+      pending &= pending - 1;
+      Param::SetFixed(paramNums[f], values[f]);
+      published++;
+   }
+
+   // Every handler write used to be a parameter write, the difference is what we saved
+   avoided += writes - published;
+   writes = 0;
+
+   uint32_t now = Timebase::Millis();
+
+   if ((now - windowStart) >= 1000)
+   {
+      Param::SetInt(Param::pubavoided, avoided);
+      avoided = 0;
+      windowStart = now;
+   }
+}
@@ -0,0 +1,101 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/cm3/cortex.h>
+#include "profiler.h"
+
+Profiler::Counters Profiler::probes[PRB_LAST];
+
+#define PROBE(name) #name,
+static const char* const names[] = { PROFILER_PROBES };
+#undef PROBE
+
+void Profiler::Init()
+{
+   dwt_enable_cycle_counter();
+   Reset();
+}
+
+void Profiler::SetPeriod(int probe, uint32_t us)
+{
+   probes[probe].period = us * CYCLES_PER_US;
+}
+
+void Profiler::Stop(int probe, uint32_t start)
+{
+   uint32_t cycles = DWT_CYCCNT - start;
+   Counters& p = probes[probe];
+
+   if (cycles < p.min) p.min = cycles;
+   if (cycles > p.max) p.max = cycles;
+   p.sum += cycles;
+   p.count++;
+
+   if (p.period == 0) return;
+
+   if (p.lastStart != 0)
+   {
+      int32_t deviation = (int32_t)(start - p.lastStart - p.period);
+      uint32_t jitter = deviation < 0 ? -deviation : deviation;
+      if (jitter > p.maxJitter) p.maxJitter = jitter;
+   }
+   p.lastStart = start | 1; // never 0
+
+   if (cycles > p.period) p.misses++;
+}
+
+uint32_t Profiler::Get(int probe, Stat stat)
+{
+   // The probes are updated from interrupts, a 64 bit sum can not be read in one go
+   bool masked = cm_mask_interrupts(true);
+   const Counters p = probes[probe];
+   cm_mask_interrupts(masked);
+
+   if (p.count == 0) return 0;
+
+   switch (stat)
+   {
+   case STAT_COUNT:  return p.count;
+   case STAT_MIN:    return p.min;
+   case STAT_MEAN:   return p.sum / p.count;
+   case STAT_MAX:    return p.max;
+   case STAT_JITTER: return p.maxJitter;
+   case STAT_MISSES: return p.misses;
+   default:          return 0;
+   }
+}
+
+const char* Profiler::GetName(int probe)
+{
+   return probe < PRB_TX0 ? names[probe] : 0;
+}
+
+void Profiler::Reset()
+{
+   for (int i = 0; i < PRB_LAST; i++)
+   {
+      probes[i].count = 0;
+      probes[i].min = 0xFFFFFFFF;
+      probes[i].max = 0;
+      probes[i].sum = 0;
+      probes[i].lastStart = 0;
+      probes[i].maxJitter = 0;
+      probes[i].misses = 0;
+   }
+}
@@ -0,0 +1,349 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <libopencm3/cm3/cortex.h>
+#include "sdobulk.h"
+#include "params.h"
+#include "stm32_can.h"
+#include "busstats.h"
+#include "timebase.h"
+#include "txsched.h"
+#include "changelog.h"
+
+// Command specifiers in byte 0, CiA 301
+#define CMD_UPLOAD            0x40  // initiate upload, client
+#define CMD_UPLOAD_REPLY      0x41  // segmented, size indicated
+#define CMD_UPLOAD_SEGMENT    0x60  // client, the reply carries the same toggle bit
+#define CMD_BLOCK_UPLOAD      0xA0  // client, subcommand in bits 0-1, bit 2 client CRC
+#define CMD_BLOCK_REPLY       0xC0  // server, bit 2 server CRC, bit 1 size indicated
+#define CMD_ABORT             0x80
+#define CMD_MASK_BLOCK        0xE0
+#define TOGGLE_BIT            0x10
+#define BLOCK_CRC             0x04
+#define BLOCK_SIZE_IND        0x02
+#define LAST_SEGMENT          0x80
+#define MAX_BLOCK_SIZE        127
+#define SEGMENT_BYTES         7
+
+enum { BLK_INITIATE = 0, BLK_END = 1, BLK_ACK = 2, BLK_START = 3 };
+
+#define ERR_TOGGLE            0x05030000
+#define ERR_COMMAND           0x05040001
+#define ERR_BLOCK_SIZE        0x05040002
+#define ERR_SEQUENCE          0x05040003
+#define ERR_SUBINDEX          0x06090011
+#define ERR_NO_DATA           0x08000024
+
+// Room for every entry plus the sequence record of SUB_CHANGED
+static uint8_t buffer[(Param::PARAM_LAST + 1) * SdoBulk::RECORD_SIZE];
+
+volatile uint8_t SdoBulk::state = IDLE;
+volatile bool SdoBulk::requestPending = false;
+uint32_t SdoBulk::request[2];
+uint32_t SdoBulk::lastRequest = 0;
+uint32_t SdoBulk::range = 0xFFFF0000;
+uint32_t SdoBulk::since = 0;
+uint8_t SdoBulk::subIndex = 0;
+uint16_t SdoBulk::size = 0;
+uint16_t SdoBulk::offset = 0;
+uint8_t SdoBulk::toggle = 0;
+uint8_t SdoBulk::blockSize = 0;
+uint8_t SdoBulk::seqno = 0;
+uint16_t SdoBulk::crc = 0;
+
+// CRC-16-CCITT, polynomial 0x1021, start value 0, as for SDO block transfers
+static uint16_t Crc16(const uint8_t* data, int len)
+{
+   uint16_t crc = 0;
+
+   for (int i = 0; i < len; i++)
+   {
+      crc ^= data[i] << 8;
+      for (int bit = 0; bit < 8; bit++)
+         crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+   }
+   return crc;
+}
+
+// Runs from the main loop. The bus accounting and the Stm32Can send queue are shared
+// with the TIM2 task and the CAN interrupts, so both are updated with interrupts masked.
+// The previous mask is restored, Idle::Calibrate runs the main loop pass masked.
+static void SendFrame(uint32_t data[2])
+{
+   uint32_t id = 0x580 + Param::GetInt(Param::nodeid);
+
+   bool masked = cm_mask_interrupts(true);
+   BusStats::CountTx(id, 8);
+   Stm32Can::GetInterface(0)->Send(id, data, 8);
+   cm_mask_interrupts(masked);
+}
+
+bool SdoBulk::HandleRx(const uint32_t data[2])
+{
+   uint8_t cmd = data[0] & 0xFF;
+   uint16_t index = (data[0] >> 8) & 0xFFFF;
+   bool block = (cmd & CMD_MASK_BLOCK) == CMD_BLOCK_UPLOAD;
+   bool ours;
+
+   if ((cmd == CMD_UPLOAD || (block && (cmd & 3) == BLK_INITIATE)) && index == INDEX_VALUES)
+      ours = true;
+   else if (state == SEGMENTED)
+      ours = (cmd & ~TOGGLE_BIT) == CMD_UPLOAD_SEGMENT || cmd == CMD_ABORT;
+   else if (state != IDLE)
+      ours = (block && (cmd & 3) != BLK_INITIATE) || cmd == CMD_ABORT;
+   else
+      ours = false;
+
+   if (ours)
+   {
+      request[0] = data[0];
+      request[1] = data[1];
+      requestPending = true;
+   }
+   return ours;
+}
+
+bool SdoBulk::Run()
+{
+   uint32_t req[2];
+   bool haveRequest;
+
+   bool masked = cm_mask_interrupts(true);
+   haveRequest = requestPending;
+   req[0] = request[0];
+   req[1] = request[1];
+   requestPending = false;
+   cm_mask_interrupts(masked);
+
+   if (haveRequest)
+   {
+      lastRequest = Timebase::Millis();
+      Process(req);
+   }
+   else if (state != IDLE && Timebase::Millis() - lastRequest > TIMEOUT_MS)
+   {
+      state = IDLE;
+   }
+
+   if (state == BLOCK_SEND) SendSegments();
+
+   return haveRequest || state == BLOCK_SEND;
+}
+
+void SdoBulk::Process(const uint32_t req[2])
+{
+   uint8_t cmd = req[0] & 0xFF;
+   bool block = (cmd & CMD_MASK_BLOCK) == CMD_BLOCK_UPLOAD;
+
+   if (cmd == CMD_ABORT)
+   {
+      state = IDLE;
+   }
+   else if (cmd == CMD_UPLOAD || (block && (cmd & 3) == BLK_INITIATE))
+   {
+      // A new initiate request replaces whatever was open
+      subIndex = req[0] >> 24;
+      if (!Snapshot(subIndex)) return;
+
+      offset = 0;
+      if (cmd == CMD_UPLOAD)
+      {
+         toggle = 0;
+         state = SEGMENTED;
+         Reply(CMD_UPLOAD_REPLY, size);
+      }
+      else if ((req[1] & 0xFF) < 1 || (req[1] & 0xFF) > MAX_BLOCK_SIZE)
+      {
+         Abort(ERR_BLOCK_SIZE);
+      }
+      else
+      {
+         // The end reply always carries our CRC, the client ignores it if it did not ask for one
+         blockSize = req[1] & 0xFF;
+         state = BLOCK_START;
+         Reply(CMD_BLOCK_REPLY | BLOCK_CRC | BLOCK_SIZE_IND, size);
+      }
+   }
+   else if (state == SEGMENTED && (cmd & ~TOGGLE_BIT) == CMD_UPLOAD_SEGMENT)
+   {
+      if ((cmd & TOGGLE_BIT) != toggle)
+      {
+         Abort(ERR_TOGGLE);
+         return;
+      }
+
+      int len = size - offset < SEGMENT_BYTES ? size - offset : SEGMENT_BYTES;
+      bool last = offset + len >= size;
+      uint32_t data[2] = { 0, 0 };
+      uint8_t* bytes = (uint8_t*)data;
+
+      bytes[0] = toggle | (SEGMENT_BYTES - len) << 1 | (last ? 1 : 0);
+      for (int i = 0; i < len; i++)
+         bytes[i + 1] = buffer[offset + i];
+
+      offset += len;
+      toggle ^= TOGGLE_BIT;
+      if (last) state = IDLE;
+      SendFrame(data);
+   }
+   else if (state == BLOCK_START && cmd == (CMD_BLOCK_UPLOAD | BLK_START))
+   {
+      seqno = 0;
+      state = BLOCK_SEND;
+   }
+   else if ((state == BLOCK_SEND || state == BLOCK_ACK) && cmd == (CMD_BLOCK_UPLOAD | BLK_ACK))
+   {
+      uint8_t ackseq = (req[0] >> 8) & 0xFF;
+      uint8_t nextSize = (req[0] >> 16) & 0xFF;
+
+      if (ackseq > seqno)
+      {
+         Abort(ERR_SEQUENCE);
+         return;
+      }
+
+      // Segments after ackseq were lost, the next block repeats them
+      offset = offset + ackseq * SEGMENT_BYTES < size ? offset + ackseq * SEGMENT_BYTES : size;
+
+      if (offset >= size)
+      {
+         uint8_t unused = (SEGMENT_BYTES - size % SEGMENT_BYTES) % SEGMENT_BYTES;
+         state = BLOCK_END;
+         Reply(CMD_BLOCK_REPLY | BLK_END | unused << 2, 0);
+      }
+      else if (nextSize < 1 || nextSize > MAX_BLOCK_SIZE)
+      {
+         Abort(ERR_BLOCK_SIZE);
+      }
+      else
+      {
+         blockSize = nextSize;
+         seqno = 0;
+         state = BLOCK_SEND;
+      }
+   }
+   else if (state == BLOCK_END && cmd == (CMD_BLOCK_UPLOAD | BLK_END))
+   {
+      state = IDLE;
+   }
+   else
+   {
+      Abort(ERR_COMMAND);
+   }
+}
+
+static uint16_t AddRecord(uint16_t pos, uint32_t id, uint32_t value)
+{
+   uint8_t* rec = &buffer[pos];
+
+   rec[0] = id;
+   rec[1] = id >> 8;
+   rec[2] = value;
+   rec[3] = value >> 8;
+   rec[4] = value >> 16;
+   rec[5] = value >> 24;
+   return pos + SdoBulk::RECORD_SIZE;
+}
+
+// Copies the selected entries into the buffer, aborts the transfer if there are none
+bool SdoBulk::Snapshot(uint8_t sub)
+{
+   uint32_t first = sub == SUB_RANGE ? range & 0xFFFF : 0;
+   uint32_t last = sub == SUB_RANGE ? range >> 16 : 0xFFFF;
+
+   if (sub != SUB_ALL && sub != SUB_RANGE && sub != SUB_CHANGED)
+   {
+      Abort(ERR_SUBINDEX);
+      return false;
+   }
+
+   size = 0;
+   if (sub == SUB_CHANGED)
+      size = AddRecord(size, 0, ChangeLog::Scan());
+
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+   {
+      Param::PARAM_NUM p = (Param::PARAM_NUM)i;
+      uint32_t id = Param::GetAttrib(p)->id;
+
+      if (sub == SUB_CHANGED)
+      {
+         if (!ChangeLog::ChangedSince(p, since)) continue;
+      }
+      else if (Param::GetType(p) != Param::TYPE_SPOTVALUE || id < first || id > last)
+      {
+         continue;
+      }
+
+      size = AddRecord(size, id, Param::Get(p));
+   }
+
+   if (size == 0)
+   {
+      Abort(ERR_NO_DATA);
+      return false;
+   }
+
+   crc = Crc16(buffer, size);
+   return true;
+}
+
+// Sends the rest of the current block while the periodic frames still find a mailbox
+void SdoBulk::SendSegments()
+{
+   int remaining = (size - offset + SEGMENT_BYTES - 1) / SEGMENT_BYTES;
+   int inBlock = remaining < blockSize ? remaining : blockSize;
+
+   while (seqno < inBlock && TxScheduler::FreeMailboxes() >= 2)
+   {
+      uint16_t pos = offset + seqno * SEGMENT_BYTES;
+      uint32_t data[2] = { 0, 0 };
+      uint8_t* bytes = (uint8_t*)data;
+
+      seqno++;
+      bytes[0] = seqno | (pos + SEGMENT_BYTES >= size ? LAST_SEGMENT : 0);
+      for (int i = 0; i < SEGMENT_BYTES && pos + i < size; i++)
+         bytes[i + 1] = buffer[pos + i];
+
+      // Set before the last segment goes out, the ack may follow right away
+      if (seqno == inBlock) state = BLOCK_ACK;
+      SendFrame(data);
+   }
+}
+
+// Initiate and end replies: command, our index and sub index, 4 bytes of data.
+// The end reply has the CRC in bytes 1-2 in place of the index.
+void SdoBulk::Reply(uint8_t cmd, uint32_t value)
+{
+   uint32_t data[2];
+
+   if ((cmd & CMD_MASK_BLOCK) == CMD_BLOCK_REPLY && (cmd & 3) == BLK_END)
+      data[0] = cmd | (uint32_t)crc << 8;
+   else
+      data[0] = cmd | INDEX_VALUES << 8 | (uint32_t)subIndex << 24;
+   data[1] = value;
+   SendFrame(data);
+}
+
+void SdoBulk::Abort(uint32_t code)
+{
+   state = IDLE;
+   Reply(CMD_ABORT, code);
+}
@@ -0,0 +1,193 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/crc.h>
+#include "telemetry.h"
+#include "hwdefs.h"
+
+#define HEADER_SIZE 10
+#define BUFFER_WORDS 192 // names and key frame of MAX_VALUES values with names up to 16 chars
+
+Param::PARAM_NUM Telemetry::values[MAX_VALUES];
+int Telemetry::count = 0;
+s32fp Telemetry::sample[MAX_VALUES];
+uint32_t Telemetry::sampleTime;
+volatile bool Telemetry::sampleFull = false;
+s32fp Telemetry::reference[MAX_VALUES];
+bool Telemetry::keyNeeded = true;
+uint8_t Telemetry::seq = 0;
+uint8_t Telemetry::sinceKey = 0;
+uint32_t Telemetry::drops = 0;
+
+// Read by the DMA, only touched while the channel is idle
+static uint32_t buffer[BUFFER_WORDS];
+
+static const Param::PARAM_NUM defaultValues[] =
+{
+   Param::opmode, Param::activate, Param::CHG_STAT, Param::udc, Param::idc, Param::uac,
+   Param::iac, Param::ulv, Param::idcdc, Param::powerac, Param::powerdcdc
+};
+
+void Telemetry::Init()
+{
+   Clear();
+   for (uint32_t i = 0; i < sizeof(defaultValues) / sizeof(defaultValues[0]); i++)
+      Add(defaultValues[i]);
+}
+
+void Telemetry::Clear()
+{
+   count = 0;
+   keyNeeded = true;
+}
+
+bool Telemetry::Add(Param::PARAM_NUM value)
+{
+   if (count >= MAX_VALUES || value >= Param::PARAM_LAST) return false;
+
+   values[count++] = value;
+   keyNeeded = true;
+   return true;
+}
+
+void Telemetry::Sample(uint32_t time)
+{
+   if (sampleFull)
+   {
+      drops++;
+      return;
+   }
+
+   for (int i = 0; i < count; i++)
+      sample[i] = Param::Get(values[i]);
+   sampleTime = time;
+   sampleFull = true;
+}
+
+uint8_t* Telemetry::BeginFrame(uint8_t* p, FrameType type, uint32_t time)
+{
+   p[0] = 0xA5;
+   p[1] = 0x5A;
+   p[2] = type;
+   p[3] = seq++;
+   p[6] = time;
+   p[7] = time >> 8;
+   p[8] = time >> 16;
+   p[9] = time >> 24;
+   return p + HEADER_SIZE;
+}
+
+// Fills in the length, pads and appends the CRC, returns the start of the next frame
+uint8_t* Telemetry::EndFrame(uint8_t* frame, uint8_t* end)
+{
+   uint32_t len = end - frame - HEADER_SIZE;
+
+   frame[4] = len;
+   frame[5] = len >> 8;
+
+   while ((end - frame) & 3)
+      *end++ = 0;
+
+   crc_reset();
+   uint32_t crc = crc_calculate_block((uint32_t*)frame, (end - frame) / 4);
+
+   end[0] = crc;
+   end[1] = crc >> 8;
+   end[2] = crc >> 16;
+   end[3] = crc >> 24;
+   return end + 4;
+}
+
+void Telemetry::Send()
+{
+   if (!sampleFull) return;
+
+   if (dma_get_number_of_data(DMA1, TLM_DMA_CHANNEL) != 0)
+   {
+      drops++;
+      sampleFull = false;
+      return;
+   }
+
+   uint8_t* start = (uint8_t*)buffer;
+   uint8_t* p = start;
+   int n = count;
+
+   if (keyNeeded || sinceKey >= KEYFRAME_INTERVAL)
+   {
+      uint8_t* frame = p;
+
+      p = BeginFrame(p, FRM_NAMES, sampleTime);
+      *p++ = CST_DIGITS;
+      *p++ = n;
+      for (int i = 0; i < n; i++)
+      {
+         for (const char* c = Param::GetAttrib(values[i])->name; *c != 0; c++)
+            *p++ = *c;
+         if (i < n - 1) *p++ = ',';
+      }
+      p = EndFrame(frame, p);
+
+      frame = p;
+      p = BeginFrame(p, FRM_KEY, sampleTime);
+      *p++ = n;
+      for (int i = 0; i < n; i++)
+      {
+         uint32_t v = sample[i];
+         *p++ = v;
+         *p++ = v >> 8;
+         *p++ = v >> 16;
+         *p++ = v >> 24;
+      }
+      p = EndFrame(frame, p);
+      keyNeeded = false;
+      sinceKey = 0;
+   }
+   else
+   {
+      uint8_t* frame = p;
+
+      p = BeginFrame(p, FRM_DELTA, sampleTime);
+      *p++ = n;
+      for (int i = 0; i < n; i++)
+      {
+         int32_t d = (int32_t)((uint32_t)sample[i] - (uint32_t)reference[i]);
+         uint32_t z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+
+         while (z >= 0x80)
+         {
+            *p++ = z | 0x80;
+            z >>= 7;
+         }
+         *p++ = z;
+      }
+      p = EndFrame(frame, p);
+      sinceKey++;
+   }
+
+   for (int i = 0; i < n; i++)
+      reference[i] = sample[i];
+   sampleFull = false;
+
+   dma_disable_channel(DMA1, TLM_DMA_CHANNEL);
+   dma_set_memory_address(DMA1, TLM_DMA_CHANNEL, (uint32_t)start);
+   dma_set_number_of_data(DMA1, TLM_DMA_CHANNEL, p - start);
+   dma_enable_channel(DMA1, TLM_DMA_CHANNEL);
+}
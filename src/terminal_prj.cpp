@@ -32,11 +32,25 @@
 #include "param_save.h"
 #include "errormessage.h"
 #include "terminalcommands.h"
+#include "pcsalerts.h"
+#include "journal.h"
+#include "txsched.h"
+#include "busstats.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "changelog.h"
 
 static void LoadDefaults(Terminal* term, char *arg);
 static void Help(Terminal* term, char *arg);
 static void PrintSerial(Terminal* term, char *arg);
 static void PrintErrors(Terminal* term, char *arg);
+static void PrintAlerts(Terminal* term, char *arg);
+static void PrintJournal(Terminal* term, char *arg);
+static void PrintTxStats(Terminal* term, char *arg);
+static void PrintBusStats(Terminal* term, char *arg);
+static void PrintProfile(Terminal* term, char *arg);
+static void TelemetryValues(Terminal* term, char *arg);
+static void PrintChanges(Terminal* term, char *arg);
 
 extern "C" const TERM_CMD termCmds[] =
 {
@@ -53,6 +67,13 @@ extern "C" const TERM_CMD termCmds[] =
   { "help", Help },
   { "serial", PrintSerial },
   { "errors", PrintErrors },
+  { "alerts", PrintAlerts },
+  { "journal", PrintJournal },
+  { "txstat", PrintTxStats },
+  { "canstat", PrintBusStats },
+  { "prof", PrintProfile },
+  { "tlm", TelemetryValues },
+  { "changes", PrintChanges },
   { NULL, NULL }
 };
 
@@ -84,3 +105,147 @@ static void Help(Terminal* term, char *arg)
    arg = arg;
    term = term;
 }
+
+static void PrintAlerts(Terminal* term, char *arg)
+{
+   AlertEvent e;
+   uint32_t age = PcsAlerts::LOG_SIZE;
+
+   arg = arg;
+   fprintf(term, "Active:");
+   for (int id = 1; id <= PcsAlerts::NUM_ALERTS; id++)
+   {
+      if (PcsAlerts::IsActive(id)) fprintf(term, " %d", id);
+   }
+   fprintf(term, "\r\n%u events, oldest first:\r\n", PcsAlerts::GetEventCount());
+
+   while (age-- > 0)
+   {
+      if (PcsAlerts::GetEvent(age, e))
+         fprintf(term, "%u ms alert %d %s\r\n", e.time, e.id, e.onset ? "on" : "off");
+   }
+}
+
+static void PrintJournal(Terminal* term, char *arg)
+{
+   static const char* const names[] = { "?", "boot", "alert on", "alert off", "chgstat", "vcufault" };
+
+   arg = arg;
+   for (const Journal::Record* r = Journal::First(); r != 0; r = Journal::Next(r))
+   {
+      const char* name = r->type < sizeof(names) / sizeof(names[0]) ? names[r->type] : names[0];
+      fprintf(term, "boot %d %u ms %s %d\r\n", r->boot, r->time, name, r->value);
+   }
+}
+
+// "txstat" prints the TX schedule with worst-case jitter, "txstat reset" clears the statistics
+static void PrintTxStats(Terminal* term, char *arg)
+{
+   arg = my_trim(arg);
+
+   if (my_strcmp(arg, "reset") == 0)
+   {
+      TxScheduler::ResetStatistics();
+      fprintf(term, "TX statistics cleared\r\n");
+      return;
+   }
+
+   for (int i = 0; i < TxScheduler::GetCount(); i++)
+   {
+      const TxSlot& s = TxScheduler::GetSlot(i);
+      fprintf(term, "%03x period %d ms phase %d ms jitter %u us\r\n", TxScheduler::GetId(i), s.period, TxScheduler::GetPhase(i), TxScheduler::GetMaxJitter(i));
+   }
+   fprintf(term, "TX queue high water %d\r\n", TxScheduler::GetQueueHighWater());
+   fprintf(term, "Sent on change %u\r\n", TxScheduler::GetEventSends());
+}
+
+// "canstat" prints frame and bit counts of every ID seen or sent, bits/s is over the last second
+static void PrintBusStats(Terminal* term, char *arg)
+{
+   arg = arg;
+   for (int i = 0; i < BusStats::TABLE_SIZE; i++)
+   {
+      const BusStats::Entry& e = BusStats::GetEntry(i);
+
+      if (e.id == BusStats::EMPTY_ID) continue;
+      fprintf(term, "%03x rx %u/%u tx %u/%u frames/bits %u bits/s\r\n", e.id, e.rxFrames, e.rxBits, e.txFrames, e.txBits, e.lastBits);
+   }
+   fprintf(term, "untracked %u\r\n", BusStats::GetUntracked());
+}
+
+// "tlm" lists the telemetry values, "tlm name1 name2 ..." replaces them
+static void TelemetryValues(Terminal* term, char *arg)
+{
+   arg = my_trim(arg);
+
+   if (*arg != 0)
+   {
+      Telemetry::Clear();
+
+      while (*arg != 0)
+      {
+         char* next = (char*)my_strchr(arg, ' ');
+
+         if (*next == ' ') *next++ = 0;
+
+         Param::PARAM_NUM idx = Param::NumFromString(arg);
+
+         if (idx == Param::PARAM_INVALID || !Telemetry::Add(idx))
+            fprintf(term, "Skipped %s\r\n", arg);
+         arg = my_trim(next);
+      }
+   }
+
+   for (int i = 0; i < Telemetry::GetCount(); i++)
+      fprintf(term, "%s\r\n", Param::GetAttrib(Telemetry::GetValue(i))->name);
+}
+
+// "prof" prints execution times in CPU cycles, "prof reset" clears them
+static void PrintProfile(Terminal* term, char *arg)
+{
+   arg = my_trim(arg);
+
+   if (my_strcmp(arg, "reset") == 0)
+   {
+      Profiler::Reset();
+      fprintf(term, "Profile cleared\r\n");
+      return;
+   }
+
+   fprintf(term, "probe count min mean max jitter misses\r\n");
+   for (int i = 0; i < Profiler::PRB_LAST; i++)
+   {
+      if (Profiler::Get(i, Profiler::STAT_COUNT) == 0) continue;
+
+      if (Profiler::GetName(i) != 0)
+         fprintf(term, "%s", Profiler::GetName(i));
+      else
+         fprintf(term, "tx%03x", TxScheduler::GetId(i - Profiler::PRB_TX0));
+
+      for (int s = Profiler::STAT_COUNT; s < Profiler::STAT_LAST; s++)
+         fprintf(term, " %u", Profiler::Get(i, (Profiler::Stat)s));
+      fprintf(term, "\r\n");
+   }
+}
+
+// "changes n" prints the sequence number and all entries changed after sequence n
+// as one JSON object, "changes" alone prints everything
+static void PrintChanges(Terminal* term, char *arg)
+{
+   uint32_t since = 0;
+   uint32_t seq = ChangeLog::Scan();
+
+   // Sequence numbers use all 32 bits, more than my_atoi() takes
+   for (char* c = my_trim(arg); *c >= '0' && *c <= '9'; c++)
+      since = since * 10 + *c - '0';
+
+   fprintf(term, "{\"seq\": %u", seq);
+   for (int i = 0; i < Param::PARAM_LAST; i++)
+   {
+      Param::PARAM_NUM p = (Param::PARAM_NUM)i;
+
+      if (ChangeLog::ChangedSince(p, since))
+         fprintf(term, ", \"%s\": %f", Param::GetAttrib(p)->name, Param::Get(p));
+   }
+   fprintf(term, "}\r\n");
+}
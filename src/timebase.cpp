@@ -0,0 +1,36 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <libopencm3/cm3/systick.h>
+#include "timebase.h"
+
+volatile uint32_t Timebase::ms = 0;
+
+uint32_t Timebase::Micros()
+{
+   uint32_t m, ticks;
+
+   // Retry if the SysTick interrupt incremented ms while we read the counter
+   do
+   {
+      m = ms;
+      ticks = systick_get_reload() - systick_get_value();
+   } while (m != ms);
+
+   return m * 1000 + ticks * 1000 / (systick_get_reload() + 1);
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <libopencm3/stm32/can.h>
+#include "txsched.h"
+#include "timebase.h"
+#include "profiler.h"
+
+#define HYPERPERIOD_SLOTS (TxScheduler::HYPERPERIOD_MS / TxScheduler::SLOT_MS)
+#define MAILBOXES 3
+
+const TxSlot* TxScheduler::table = 0;
+int TxScheduler::count = 0;
+uint16_t TxScheduler::slot = 0;
+uint8_t TxScheduler::phase[MAX_SLOTS];
+uint32_t TxScheduler::lastSent[MAX_SLOTS];
+uint32_t TxScheduler::lastDue[MAX_SLOTS];
+uint32_t TxScheduler::maxJitter[MAX_SLOTS];
+uint8_t TxScheduler::queueHighWater = 0;
+uint32_t TxScheduler::eventPending = 0;
+uint32_t TxScheduler::eventSends = 0;
+bool TxScheduler::eventSend = false;
+ControlInputs TxScheduler::lastInputs;
+bool TxScheduler::haveInputs = false;
+
+int TxScheduler::FreeMailboxes()
+{
+   uint32_t tsr = CAN_TSR(CAN1);
+   return ((tsr & CAN_TSR_TME0) != 0) + ((tsr & CAN_TSR_TME1) != 0) + ((tsr & CAN_TSR_TME2) != 0);
+}
+
+void TxScheduler::Init(const TxSlot* t, int n)
+{
+   uint8_t load[HYPERPERIOD_SLOTS] = { 0 };
+
+   table = t;
+   count = n < MAX_SLOTS ? n : MAX_SLOTS;
+
+   // Greedy, in table order: take the phase whose busiest slot is least loaded,
+   // ties go to the lowest total load so the frames spread over the whole period.
+   for (int i = 0; i < count; i++)
+   {
+      int periodSlots = table[i].period / SLOT_MS;
+      int bestPeak = 0xFF, bestSum = 0xFFFF;
+
+      for (int p = 0; p < periodSlots; p++)
+      {
+         int peak = 0, sum = 0;
+
+         for (int s = p; s < HYPERPERIOD_SLOTS; s += periodSlots)
+         {
+            peak = load[s] > peak ? load[s] : peak;
+            sum += load[s];
+         }
+
+         if (peak < bestPeak || (peak == bestPeak && sum < bestSum))
+         {
+            bestPeak = peak;
+            bestSum = sum;
+            phase[i] = p;
+         }
+      }
+
+      if (table[i].id & TxSlot::ID_CANLOGID) continue;
+
+      for (int s = phase[i]; s < HYPERPERIOD_SLOTS; s += periodSlots)
+         load[s]++;
+   }
+
+   ResetStatistics();
+}
+
+uint16_t TxScheduler::GetId(int i)
+{
+   uint16_t id = table[i].id;
+
+   if (id & TxSlot::ID_CANLOGID)
+      return Param::GetInt(Param::canlogid) + (id & ~TxSlot::ID_CANLOGID);
+   return id;
+}
+
+void TxScheduler::Run(bool canEnable, uint16_t minGapMs)
+{
+   const ControlInputs in = PCSCan::CaptureInputs();
+   uint8_t changed = haveInputs ? PCSCan::ChangedInputs(lastInputs, in) : 0;
+   int pending = MAILBOXES - FreeMailboxes();
+
+   lastInputs = in;
+   haveInputs = true;
+
+   for (int i = 0; i < count; i++)
+   {
+      const TxSlot& s = table[i];
+      int periodSlots = s.period / SLOT_MS;
+      uint32_t bit = 1UL << i;
+
+      if (s.onChange & changed) eventPending |= bit;
+
+      int toDue = (phase[i] + periodSlots - slot % periodSlots) % periodSlots;
+      bool due = toDue == 0;
+      bool event = !due && (eventPending & bit) != 0;
+
+      if (!due && !event) continue;
+
+      if (s.pcsFrame && !canEnable)
+      {
+         lastSent[i] = 0; // no jitter across a pause
+         lastDue[i] = 0;
+         eventPending &= ~bit;
+         continue;
+      }
+
+      uint32_t now = Timebase::Micros();
+
+      if (event)
+      {
+         // Keep the guard, a later slot sends it once the gap has passed
+         if (lastSent[i] != 0 && now - lastSent[i] < minGapMs * 1000UL) continue;
+         // The periodic frame comes soon enough and carries the change as well
+         if (toDue * SLOT_MS < minGapMs) continue;
+      }
+      eventPending &= ~bit;
+
+      uint32_t start = Profiler::Start();
+      eventSend = event;
+      bool sent = s.build(in);
+      eventSend = false;
+      Profiler::Stop(Profiler::PRB_TX0 + i, start);
+
+      if (!sent)
+      {
+         lastDue[i] = 0; // a pause as well, decimated logger frames are not measured
+         continue;
+      }
+
+      if (event)
+      {
+         eventSends++;
+      }
+      else
+      {
+         if (lastDue[i] != 0)
+         {
+            int32_t deviation = (int32_t)(now - lastDue[i]) - s.period * 1000;
+            uint32_t jitter = deviation < 0 ? -deviation : deviation;
+            if (jitter > maxJitter[i]) maxJitter[i] = jitter;
+         }
+         lastDue[i] = now | 1;
+      }
+      lastSent[i] = now | 1; // never 0
+      pending++;
+   }
+
+   if (pending > queueHighWater) queueHighWater = pending;
+
+   slot = (slot + 1) % HYPERPERIOD_SLOTS;
+}
+
+void TxScheduler::ResetStatistics()
+{
+   for (int i = 0; i < count; i++)
+   {
+      lastSent[i] = 0;
+      lastDue[i] = 0;
+      maxJitter[i] = 0;
+   }
+   queueHighWater = 0;
+   eventSends = 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of the Model 3 PCS Controller project.
+ *
+ * Copyright (C) 2026 Wim Boone
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workqueue.h"
+
+const WorkFunction* WorkQueue::jobs = 0;
+int WorkQueue::count = 0;
+uint32_t WorkQueue::pending = 0;
+uint32_t WorkQueue::overruns = 0;
+
+void WorkQueue::Init(const WorkFunction* j, int n)
+{
+   jobs = j;
+   count = n < MAX_JOBS ? n : MAX_JOBS;
+}
+
+void WorkQueue::Post(int job)
+{
+   uint32_t bit = 1UL << job;
+
+   if (job >= count) return;
+
+   if (__atomic_fetch_or(&pending, bit, __ATOMIC_RELEASE) & bit)
+      __atomic_fetch_add(&overruns, 1, __ATOMIC_RELAXED);
+}
+
+bool WorkQueue::Run()
+{
+   uint32_t p;
+   bool ran = false;
+
+   while ((p = __atomic_load_n(&pending, __ATOMIC_ACQUIRE)) != 0)
+   {
+      int job = __builtin_ctz(p);
+
+      // Cleared before running, so a post during the job runs it again
+      __atomic_fetch_and(&pending, ~(1UL << job), __ATOMIC_ACQ_REL);
+      jobs[job]();
+      ran = true;
+   }
+   return ran;
+}
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+#
+# This file is part of the Model 3 PCS Controller project.
+#
+# Copyright (C) 2026 Wim Boone
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+"""Benchmarks a full refresh of the display values over SDO.
+
+Reads every display value three ways and prints, per refresh, the CAN frames
+each side sent, the round trips (requests the client had to wait on) and the
+time taken:
+
+   expedited  one upload per value by unique ID, as the web interface does
+   segmented  bulk object 0x4120 by segmented upload, 7 bytes per round trip
+   block      bulk object 0x4120 by block upload, up to 127 segments per ack
+   changed    block upload of only the entries changed since the previous
+              refresh, sequence number written to 0x4122 first
+
+The bulk format is described in include/sdobulk.h. Uses Linux SocketCAN, no
+other packages needed:
+
+   sdobench.py --iface can0 --node 49 --runs 5
+"""
+import argparse
+import socket
+import struct
+import sys
+import time
+
+INDEX_VALUES = 0x4120
+INDEX_SINCE = 0x4122
+SUB_ALL, SUB_CHANGED = 0, 2
+INDEX_PARAM_UID = 0x2100
+BLOCK_SIZE = 127
+
+
+class SdoError(Exception):
+    pass
+
+
+class SocketCanBus:
+    """Raw SocketCAN socket that only receives the SDO replies of one node"""
+    FRAME = struct.Struct("<IB3x8s")
+
+    def __init__(self, iface, node, timeout):
+        self.sock = socket.socket(socket.AF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+        reply_id = 0x580 + node
+        self.sock.setsockopt(socket.SOL_CAN_RAW, socket.CAN_RAW_FILTER, struct.pack("=II", reply_id, 0x7FF))
+        self.sock.settimeout(timeout)
+        self.sock.bind((iface,))
+
+    def send(self, can_id, data):
+        self.sock.send(self.FRAME.pack(can_id, len(data), bytes(data).ljust(8, b"\0")))
+
+    def recv(self):
+        try:
+            can_id, dlc, data = self.FRAME.unpack(self.sock.recv(16))
+        except socket.timeout:
+            raise SdoError("timeout")
+        return data[:dlc]
+
+
+class SdoClient:
+    """SDO client that counts what it costs"""
+
+    def __init__(self, bus, node):
+        self.bus, self.node = bus, node
+        self.sent = self.received = self.round_trips = 0
+        self.since = 0
+
+    def send(self, data, expect_reply=True):
+        self.bus.send(0x600 + self.node, data)
+        self.sent += 1
+        if expect_reply:
+            self.round_trips += 1
+
+    def recv(self):
+        data = self.bus.recv()
+        self.received += 1
+        if data[0] == 0x80:
+            raise SdoError("abort 0x%08x" % struct.unpack_from("<I", data, 4))
+        return data
+
+    def read_expedited(self, index, sub):
+        self.send(struct.pack("<BHBI", 0x40, index, sub, 0))
+        data = self.recv()
+        if data[0] & 0xE3 != 0x43:
+            raise SdoError("not an expedited reply: %s" % data.hex())
+        return struct.unpack_from("<i", data, 4)[0]
+
+    def write_expedited(self, index, sub, value):
+        self.send(struct.pack("<BHBI", 0x23, index, sub, value))
+        data = self.recv()
+        if data[0] != 0x60:
+            raise SdoError("not a write reply: %s" % data.hex())
+
+    def read_segmented(self, index, sub):
+        self.send(struct.pack("<BHBI", 0x40, index, sub, 0))
+        data = self.recv()
+        if data[0] != 0x41:
+            raise SdoError("not a segmented reply: %s" % data.hex())
+        size = struct.unpack_from("<I", data, 4)[0]
+        result, toggle = bytearray(), 0
+        while True:
+            self.send(bytes([0x60 | toggle]) + bytes(7))
+            data = self.recv()
+            if data[0] & 0x10 != toggle:
+                raise SdoError("toggle bit mismatch")
+            result += data[1:8 - ((data[0] >> 1) & 7)]
+            toggle ^= 0x10
+            if data[0] & 1:
+                break
+        if len(result) != size:
+            raise SdoError("got %d bytes, expected %d" % (len(result), size))
+        return bytes(result)
+
+    def read_block(self, index, sub):
+        self.send(struct.pack("<BHBBB2x", 0xA4, index, sub, BLOCK_SIZE, 0))
+        data = self.recv()
+        if data[0] & 0xE1 != 0xC0:
+            raise SdoError("not a block reply: %s" % data.hex())
+        server_crc = data[0] & 4
+        size = struct.unpack_from("<I", data, 4)[0]
+        self.send(bytes([0xA3]) + bytes(7))
+        result = bytearray()
+        while True:
+            seqno = 0
+            while True:
+                data = self.recv()
+                if data[0] & 0x7F != seqno + 1:
+                    raise SdoError("segment %d of a block lost" % (seqno + 1))
+                seqno += 1
+                result += data[1:]
+                if data[0] & 0x80 or seqno == BLOCK_SIZE:
+                    break
+            self.send(bytes([0xA2, seqno, BLOCK_SIZE]) + bytes(5))
+            if data[0] & 0x80:
+                break
+        data = self.recv()
+        if data[0] & 0xE3 != 0xC1:
+            raise SdoError("not a block end: %s" % data.hex())
+        del result[len(result) - ((data[0] >> 2) & 7):]
+        self.send(bytes([0xA1]) + bytes(7), expect_reply=False)
+        if server_crc and struct.unpack_from("<H", data, 1)[0] != crc16(result):
+            raise SdoError("CRC mismatch")
+        if len(result) != size:
+            raise SdoError("got %d bytes, expected %d" % (len(result), size))
+        return bytes(result)
+
+
+def crc16(data):
+    """CRC-16-CCITT as used by SDO block transfers"""
+    crc = 0
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def decode_values(data):
+    """{id: value} from the packed bulk records"""
+    return {uid: raw / 32 for uid, raw in struct.iter_unpack("<Hi", data)}
+
+
+def read_changed(client):
+    """{id: value} of the entries changed since client.since, advances client.since"""
+    client.write_expedited(INDEX_SINCE, 0, client.since)
+    data = client.read_block(INDEX_VALUES, SUB_CHANGED)
+    uid, client.since = struct.unpack_from("<HI", data)
+    return decode_values(data[6:])
+
+
+def refresh(client, method, ids):
+    if method == "expedited":
+        return {uid: client.read_expedited(INDEX_PARAM_UID | uid >> 8, uid & 0xFF) / 32 for uid in ids}
+    if method == "segmented":
+        return decode_values(client.read_segmented(INDEX_VALUES, SUB_ALL))
+    if method == "changed":
+        return read_changed(client)
+    return decode_values(client.read_block(INDEX_VALUES, SUB_ALL))
+
+
+def benchmark(bus, node, runs, out=sys.stdout):
+    # The value IDs for the expedited reads come from a bulk read
+    ids = sorted(decode_values(SdoClient(bus, node).read_block(INDEX_VALUES, SUB_ALL)))
+    print("%d values, %d runs" % (len(ids), runs), file=out)
+    print("%-10s %8s %8s %11s %8s %9s" % ("method", "req", "reply", "round trips", "entries", "ms"), file=out)
+    for method in ("expedited", "segmented", "block", "changed"):
+        client = SdoClient(bus, node)
+        if method == "changed":
+            read_changed(client)  # the first one returns everything
+            client.sent = client.received = client.round_trips = 0
+        entries = 0
+        start = time.monotonic()
+        for _ in range(runs):
+            values = refresh(client, method, ids)
+            entries += len(values)
+            if method != "changed" and len(values) != len(ids):
+                raise SdoError("%s returned %d values" % (method, len(values)))
+        elapsed = (time.monotonic() - start) * 1000 / runs
+        print("%-10s %8d %8d %11d %8d %9.1f" % (method, client.sent / runs, client.received / runs,
+                                                client.round_trips / runs, entries / runs, elapsed), file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--iface", default="can0")
+    parser.add_argument("--node", type=int, default=49, help="nodeid parameter of the PCS controller")
+    parser.add_argument("--runs", type=int, default=5, help="refreshes per method")
+    parser.add_argument("--timeout", type=float, default=0.5, help="reply timeout in s")
+    args = parser.parse_args()
+
+    try:
+        benchmark(SocketCanBus(args.iface, args.node, args.timeout), args.node, args.runs)
+    except (SdoError, OSError) as e:
+        sys.exit("sdobench: %s" % e)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+#
+# This file is part of the Model 3 PCS Controller project.
+#
+# Copyright (C) 2026 Wim Boone
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+"""Decodes the binary telemetry stream of the telemetry USART into CSV.
+
+The frame format is described in include/telemetry.h. Reads a capture file or
+a serial port and writes one CSV line per sample, with time in ms first.
+Frames with a bad CRC are skipped, lost frames are reported on stderr.
+
+   tlm2csv.py capture.bin > log.csv
+   tlm2csv.py /dev/ttyUSB0 --baud 921600 > log.csv
+"""
+import argparse
+import struct
+import sys
+
+FRM_KEY, FRM_DELTA, FRM_NAMES = 0, 1, 2
+HEADER_SIZE = 10
+
+
+def stm32_crc(data):
+    """CRC-32 of the STM32 CRC unit over little endian words"""
+    crc = 0xFFFFFFFF
+    for (word,) in struct.iter_unpack("<I", data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) & 0xFFFFFFFF if crc & 0x80000000 else (crc << 1) & 0xFFFFFFFF
+    return crc
+
+
+def varints(payload, count):
+    values, shift, value = [], 0, 0
+    for b in payload:
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            values.append((value >> 1) ^ -(value & 1))
+            shift, value = 0, 0
+            if len(values) == count:
+                break
+    return values
+
+
+class Decoder:
+    def __init__(self, out):
+        self.out = out
+        self.buf = bytearray()
+        self.names = None
+        self.scale = 1
+        self.values = None
+        self.seq = None
+        self.lost = 0
+        self.crcerrors = 0
+
+    def feed(self, data):
+        self.buf += data
+        while True:
+            start = self.buf.find(b"\xA5\x5A")
+            if start < 0:
+                del self.buf[:-1]
+                return
+            del self.buf[:start]
+            if len(self.buf) < HEADER_SIZE:
+                return
+            length = self.buf[4] | self.buf[5] << 8
+            padded = (HEADER_SIZE + length + 3) & ~3
+            if len(self.buf) < padded + 4:
+                return
+            frame = bytes(self.buf[:padded])
+            (crc,) = struct.unpack_from("<I", self.buf, padded)
+            if stm32_crc(frame) != crc:
+                # Not a frame after all, resync after this sync pattern
+                self.crcerrors += 1
+                del self.buf[:2]
+                continue
+            del self.buf[:padded + 4]
+            self.frame(frame[2], frame[3], struct.unpack_from("<I", frame, 6)[0],
+                       frame[HEADER_SIZE:HEADER_SIZE + length])
+
+    def frame(self, ftype, seq, time, payload):
+        if self.seq is not None and seq != (self.seq + 1) & 0xFF:
+            self.lost += (seq - self.seq - 1) & 0xFF
+            # A delta on top of a lost frame is meaningless, wait for the next key frame
+            self.values = None
+        self.seq = seq
+
+        if ftype == FRM_NAMES:
+            self.scale = 1 << payload[0]
+            names = payload[2:].decode("ascii").split(",")
+            if names != self.names:
+                self.names = names
+                self.out.write("time," + ",".join(names) + "\n")
+            return
+        if self.names is None:
+            return
+        count = payload[0]
+        if ftype == FRM_KEY:
+            self.values = list(struct.unpack_from("<%di" % count, payload, 1))
+        elif ftype == FRM_DELTA and self.values is not None:
+            self.values = [v + d for v, d in zip(self.values, varints(payload[1:], count))]
+        else:
+            return
+        self.out.write("%u,%s\n" % (time, ",".join("%g" % (v / self.scale) for v in self.values)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="capture file or serial port")
+    parser.add_argument("--baud", type=int, default=921600, help="baud rate when reading a serial port")
+    args = parser.parse_args()
+
+    decoder = Decoder(sys.stdout)
+
+    if args.input.startswith("/dev/"):
+        import serial
+        port = serial.Serial(args.input, args.baud, timeout=1)
+        try:
+            while True:
+                decoder.feed(port.read(4096))
+        except KeyboardInterrupt:
+            pass
+    else:
+        with open(args.input, "rb") as f:
+            decoder.feed(f.read())
+
+    sys.stderr.write("%d frames lost, %d CRC errors\n" % (decoder.lost, decoder.crcerrors))
+
+
+if __name__ == "__main__":
+    main()